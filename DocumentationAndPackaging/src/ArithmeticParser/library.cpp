@@ -1 +0,0 @@
-#include "library.h"
@@ -1,10 +0,0 @@
-#pragma once
-
-#include "continuation.h"
-#include "Environment.h"
-#include "expression.hpp"
-#include "parse.h"
-#include "pointer.h"
-#include "step.h"
-#include "value.h"
-
@@ -2,7 +2,17 @@
 
 #include <utility>
 
-PTR(Environment) Environment::empty = NEW(EmptyEnv)();
+#include "stats.h"
+
+/**
+ * Made on first use rather than during static initialization, so a
+ * program that never evaluates anything does not pay for it and no
+ * other static initializer can see it unset.
+ */
+PTR(Environment) Environment::empty() {
+    static PTR(Environment) environment = NEW(EmptyEnv)();
+    return environment;
+}
 
 PTR(Value)EmptyEnv::lookup(std::string findName) {
     throw std::runtime_error("free variable: " + findName);
@@ -11,6 +21,7 @@ PTR(Value)EmptyEnv::lookup(std::string findName) {
 EmptyEnv::EmptyEnv() = default;
 
 PTR(Value)ExtendedEnv::lookup(std::string findName) {
+    STAT_COUNT(linksWalked);
     if (findName == name) {
         return val;
     } else {
@@ -13,7 +13,10 @@ class Environment {
 public:
     virtual PTR(Value) lookup(std::string findName) = 0;
 
-    static PTR(Environment) empty;
+    /**
+     * @return the environment with no variables bound.
+     */
+    static PTR(Environment) empty();
 };
 
 class EmptyEnv : public Environment {
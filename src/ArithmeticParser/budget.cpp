@@ -0,0 +1,209 @@
+#include <climits>
+#include <thread>
+#include "budget.h"
+#include "parse.h"
+#include "step.h"
+#include "Environment.h"
+#include "value.h"
+#include "../catch/catch.hpp"
+
+thread_local Budget *Budget::current = nullptr;
+
+static const char *abortMessage(EvaluationAborted::reasonT reason) {
+    switch (reason) {
+        case EvaluationAborted::OutOfFuel:
+            return "out of fuel";
+        case EvaluationAborted::DeadlineExceeded:
+            return "deadline exceeded";
+        case EvaluationAborted::MemoryExceeded:
+            return "memory limit exceeded";
+        default:
+            return "evaluation cancelled";
+    }
+}
+
+EvaluationAborted::EvaluationAborted(reasonT reason) : std::runtime_error(abortMessage(reason)) {
+    this->reason = reason;
+}
+
+Budget::Budget(long fuel, std::chrono::milliseconds timeout, const std::atomic<bool> *cancel, long memory) {
+    this->fuelLeft = fuel < 0 ? LONG_MAX : fuel;
+    this->taken = 0;
+    this->hasDeadline = timeout.count() > 0;
+    this->deadline = std::chrono::steady_clock::now() + timeout;
+    this->cancel = cancel;
+    this->account = new Account(memory);
+    startInterval();
+}
+
+/**
+ * Gives up the budget's hold on its account, which goes once every
+ * block charged to it is freed too.
+ */
+Budget::~Budget() {
+    account->release(1);
+}
+
+long Budget::stepsTaken() const {
+    return taken + interval - untilCheck;
+}
+
+long Budget::liveBytes() const {
+    return account->held.load(std::memory_order_acquire) - 1;
+}
+
+long Budget::peakBytes() const {
+    return account->peak;
+}
+
+Budget::Account::Account(long limit) : held(1) {
+    this->limit = limit;
+    this->peak = 0;
+}
+
+Budget::Scope::Scope(Budget *budget) {
+    this->previous = current;
+    current = budget;
+}
+
+Budget::Scope::~Scope() {
+    current = previous;
+}
+
+/**
+ * Ends an interval: the interval's steps come out of the fuel, and
+ * the cancel flag and the clock are checked. An interval never spans
+ * more steps than the fuel left plus one, so running out of fuel is
+ * noticed on the first step over the limit.
+ */
+void Budget::check() {
+    taken += interval;
+    fuelLeft -= interval;
+    interval = 0;
+    untilCheck = 0;
+    if (cancel != nullptr && cancel->load(std::memory_order_relaxed))
+        throw EvaluationAborted(EvaluationAborted::Cancelled);
+    if (hasDeadline && std::chrono::steady_clock::now() >= deadline)
+        throw EvaluationAborted(EvaluationAborted::DeadlineExceeded);
+    if (fuelLeft < 0)
+        throw EvaluationAborted(EvaluationAborted::OutOfFuel);
+    startInterval();
+}
+
+/**
+ * Takes back the allocation that went over the quota, which is never
+ * made, and stops the evaluation. The budget is alive, so this never
+ * frees the account.
+ */
+void Budget::Account::exceeded(size_t bytes) {
+    held.fetch_sub(static_cast<long>(bytes), std::memory_order_relaxed);
+    throw EvaluationAborted(EvaluationAborted::MemoryExceeded);
+}
+
+void Budget::startInterval() {
+    interval = fuelLeft < checkInterval ? fuelLeft + 1 : checkInterval;
+    untilCheck = interval;
+}
+
+TEST_CASE("evaluation budgets") {
+    PTR(Expression) forever = parseSource("_let f = _fun (f) _fun (n) f(f)(n + 1) _in f(f)(0)");
+    PTR(Expression) small = parseSource("1 + 2 * 3");
+
+    SECTION("fuel") {
+        Budget exact(5, std::chrono::milliseconds(0));
+        Budget tooLittle(4, std::chrono::milliseconds(0));
+        {
+            Budget::Scope scope(&exact);
+            CHECK(small->interpret(Environment::empty())->toString() == "7");
+            CHECK(exact.stepsTaken() == 5);
+        }
+        {
+            Budget::Scope scope(&tooLittle);
+            CHECK_THROWS_WITH(small->interpret(Environment::empty()), "out of fuel");
+        }
+        Budget steps(100000, std::chrono::milliseconds(0));
+        Budget::Scope scope(&steps);
+        CHECK_THROWS_AS(Step::interpBySteps(forever), EvaluationAborted);
+        CHECK(steps.stepsTaken() == 100001);
+    }
+
+    SECTION("deadline") {
+        Budget budget(-1, std::chrono::milliseconds(20));
+        Budget::Scope scope(&budget);
+        try {
+            Step::interpBySteps(forever);
+            FAIL("an endless program finished");
+        } catch (EvaluationAborted &exn) {
+            CHECK(exn.reason == EvaluationAborted::DeadlineExceeded);
+        }
+    }
+
+    SECTION("cancel") {
+        std::atomic<bool> cancel(false);
+        Budget budget(-1, std::chrono::milliseconds(0), &cancel);
+        std::thread canceller([&cancel] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            cancel = true;
+        });
+        {
+            Budget::Scope scope(&budget);
+            CHECK_THROWS_WITH(Step::interpBySteps(forever), "evaluation cancelled");
+        }
+        canceller.join();
+    }
+
+    SECTION("memory") {
+        PTR(Expression) growing = parseSource("_let f = _fun (f) _fun (n) 1 + f(f)(n + 1) _in f(f)(0)");
+        Budget quota(-1, std::chrono::milliseconds(0), nullptr, 1 << 20);
+        {
+            Budget::Scope scope(&quota);
+            CHECK_THROWS_WITH(Step::interpBySteps(growing), "memory limit exceeded");
+        }
+        CHECK(quota.peakBytes() <= 1 << 20);
+        CHECK(quota.peakBytes() > 1 << 19);
+
+        PTR(Expression) count = parseSource("_let count = _fun(count) _fun(n)\n"
+                                            "_if n == 0 _then 0 _else 1 + count(count)(n + -1)\n"
+                                            "_in count(count)(1000)");
+        Budget measured(-1, std::chrono::milliseconds(0));
+        {
+            Budget::Scope scope(&measured);
+            CHECK(Step::interpBySteps(count)->toString() == "1000");
+        }
+        CHECK(measured.peakBytes() > (long) (1000 * sizeof(Value)));
+        CHECK(measured.peakBytes() < 1 << 20);
+    }
+
+    SECTION("memory freed elsewhere") {
+        Budget budget(-1, std::chrono::milliseconds(0));
+        PTR(Value) before = NEW(NumberValue)(1);
+        PTR(Value) made;
+        PTR(Value) outlives;
+        {
+            Budget::Scope scope(&budget);
+            made = NEW(NumberValue)(2);
+            long live = budget.liveBytes();
+            CHECK(live > 0);
+            before = nullptr;
+            CHECK(budget.liveBytes() == live);
+            {
+                Budget inner(-1, std::chrono::milliseconds(0));
+                Budget::Scope innerScope(&inner);
+                outlives = NEW(NumberValue)(3);
+                CHECK(inner.liveBytes() == live);
+            }
+            CHECK(budget.liveBytes() == live);
+        }
+        std::thread([&made, &outlives] {
+            made = nullptr;
+            outlives = nullptr;
+        }).join();
+        CHECK(budget.liveBytes() == 0);
+        CHECK(budget.peakBytes() > 0);
+    }
+
+    SECTION("no budget") {
+        Budget::Scope scope(nullptr);
+        CHECK(small->interpret(Environment::empty())->toString() == "7");
+    }
+}
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include "heap.h"
+
+/**
+ * Thrown when an evaluation runs out of fuel, passes its deadline or
+ * is cancelled. It is a `runtime_error`, so existing error handling
+ * reports it, but callers can catch it separately to tell a program
+ * that was stopped from a program that failed.
+ */
+class EvaluationAborted : public std::runtime_error {
+public:
+    typedef enum {
+        OutOfFuel,
+        DeadlineExceeded,
+        Cancelled,
+        MemoryExceeded
+    } reasonT;
+
+    reasonT reason;
+
+    explicit EvaluationAborted(reasonT reason);
+};
+
+/**
+ * Limits on one evaluation: at most `fuel` steps, a wall-clock
+ * deadline, a flag another thread can set to cancel it and a quota
+ * of live heap bytes.
+ *
+ * While a `Budget::Scope` is alive, `interpret` charges one step per
+ * expression it interprets and `Step::run` one step per step, and
+ * throws `EvaluationAborted` once a limit is reached. Charging a step
+ * is a decrement and a branch; the clock and the cancel flag are only
+ * looked at every `checkInterval` steps.
+ *
+ * Every object made with `NEW` on the thread is charged to the
+ * budget's `Account`, and credited back when it is freed, on whatever
+ * thread, so the budget knows the evaluation's live and peak heap
+ * bytes. Freeing an object made outside the scope credits nothing.
+ */
+class Budget {
+public:
+    static const long checkInterval = 1024;
+
+    /**
+     * @param fuel steps allowed, or negative for no limit.
+     * @param timeout time allowed from now, or zero or less for no limit.
+     * @param cancel evaluation stops soon after this becomes true; may be null.
+     * @param memory live heap bytes allowed, or negative for no limit.
+     */
+    Budget(long fuel, std::chrono::milliseconds timeout, const std::atomic<bool> *cancel = nullptr,
+           long memory = -1);
+
+    Budget(const Budget &) = delete;
+
+    Budget &operator=(const Budget &) = delete;
+
+    ~Budget();
+
+    /**
+     * @return the steps charged so far.
+     */
+    long stepsTaken() const;
+
+    /**
+     * @return the heap bytes charged to the budget that are still live.
+     */
+    long liveBytes() const;
+
+    /**
+     * @return the most heap bytes the evaluation has had live at once.
+     */
+    long peakBytes() const;
+
+    /**
+     * Makes `budget` the one charged on this thread until the scope
+     * ends, when the previous one (if any) is charged again. A null
+     * `budget` means no limits.
+     */
+    class Scope {
+    public:
+        explicit Scope(Budget *budget);
+
+        ~Scope();
+
+    private:
+        Budget *previous;
+    };
+
+    /**
+     * Charges one step to this thread's budget, if it has one.
+     * @throws Throws `EvaluationAborted` if a limit is reached.
+     */
+    static void charge() {
+        Budget *budget = current;
+        if (budget != nullptr && --budget->untilCheck <= 0)
+            budget->check();
+    }
+
+    /**
+     * The heap bytes live under one budget. Each block charged to it
+     * remembers it, so the block is credited back to it when freed on
+     * any thread, and it outlives its budget until the last such block
+     * is freed.
+     */
+    class Account {
+    public:
+        explicit Account(long limit);
+
+        /**
+         * Charges an allocation of `bytes` made on a thread running
+         * under the budget.
+         * @throws Throws `EvaluationAborted` if that exceeds the quota.
+         */
+        void charge(size_t bytes) {
+            long live = held.fetch_add(static_cast<long>(bytes), std::memory_order_relaxed)
+                        + static_cast<long>(bytes) - 1;
+            if (live > peak) {
+                if (limit >= 0 && live > limit)
+                    exceeded(bytes);
+                peak = live;
+            }
+        }
+
+        /**
+         * Credits a freed allocation of `bytes`, and deletes the
+         * account if its budget is gone and nothing else is live.
+         */
+        void release(size_t bytes) {
+            if (held.fetch_sub(static_cast<long>(bytes), std::memory_order_acq_rel) == static_cast<long>(bytes))
+                delete this;
+        }
+
+    private:
+        std::atomic<long> held; /* live bytes, plus one while the budget is alive */
+        long limit;
+        long peak;              /* only changed on threads running under the budget */
+
+        void exceeded(size_t bytes);
+
+        friend class Budget;
+    };
+
+    /**
+     * @return the account of this thread's budget, or null if it has none.
+     */
+    static Account *currentAccount() {
+        Budget *budget = current;
+        return budget == nullptr ? nullptr : budget->account;
+    }
+
+private:
+    static thread_local Budget *current;
+
+    long fuelLeft;
+    long taken;
+    long interval;   /* steps between the last check and the next one */
+    long untilCheck; /* steps left before the next check */
+    bool hasDeadline;
+    std::chrono::steady_clock::time_point deadline;
+    const std::atomic<bool> *cancel;
+    Account *account;
+
+    void check();
+
+    void startInterval();
+};
+
+/**
+ * A `std::allocator` that charges and credits a `Budget::Account` and
+ * reports to the `HeapProfile` under `Owner`, the type the block was
+ * allocated for. Rebinding it, as `allocate_shared` does to make room
+ * for the control block, keeps both; `allocate_shared` keeps a copy in
+ * the control block to free the block with, so the free is credited to
+ * the account that was charged.
+ */
+template<class T, class Owner = T>
+class ChargedAllocator {
+public:
+    typedef T value_type;
+
+    Budget::Account *account; /* charged for blocks from this allocator, or null for none */
+
+    explicit ChargedAllocator(Budget::Account *account = nullptr) {
+        this->account = account;
+    }
+
+    template<class U>
+    ChargedAllocator(const ChargedAllocator<U, Owner> &other) {
+        this->account = other.account;
+    }
+
+    T *allocate(size_t count) {
+        if (account != nullptr)
+            account->charge(count * sizeof(T));
+        T *pointer = std::allocator<T>().allocate(count);
+        if (HeapProfile::enabled.load(std::memory_order_relaxed))
+            HeapProfile::allocated(HeapProfile::countsFor<Owner>(), count * sizeof(T));
+        return pointer;
+    }
+
+    void deallocate(T *pointer, size_t count) {
+        if (account != nullptr)
+            account->release(count * sizeof(T));
+        if (HeapProfile::enabled.load(std::memory_order_relaxed))
+            HeapProfile::freed(HeapProfile::countsFor<Owner>(), count * sizeof(T));
+        std::allocator<T>().deallocate(pointer, count);
+    }
+};
+
+template<class T, class U, class Owner>
+bool operator==(const ChargedAllocator<T, Owner> &a, const ChargedAllocator<U, Owner> &b) {
+    return a.account == b.account;
+}
+
+template<class T, class U, class Owner>
+bool operator!=(const ChargedAllocator<T, Owner> &a, const ChargedAllocator<U, Owner> &b) {
+    return a.account != b.account;
+}
+
+/**
+ * What `NEW(T)` expands to: `make_shared`, with the object and its
+ * reference counts charged to the thread's `Budget` as one block.
+ */
+template<class T, class... Args>
+std::shared_ptr<T> makeCharged(Args &&... args) {
+    return std::allocate_shared<T>(ChargedAllocator<T>(Budget::currentAccount()), std::forward<Args>(args)...);
+}
@@ -0,0 +1,181 @@
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include "cache.h"
+#include "parse.h"
+#include "pool.h"
+#include "budget.h"
+#include "trace.h"
+#include "../catch/catch.hpp"
+
+ProgramCache::ProgramCache(size_t capacity, int shards) : hitCount(0), missCount(0), evictionCount(0) {
+    if (shards < 1)
+        shards = 1;
+    this->shardCapacity = (capacity + shards - 1) / shards;
+    if (this->shardCapacity == 0)
+        this->shardCapacity = 1;
+    for (int i = 0; i < shards; i++)
+        this->shards.emplace_back(new Shard());
+}
+
+PTR(Expression) ProgramCache::parsed(const std::string &source) {
+    Entry entry = lookup(source);
+    if (entry.parsed != nullptr)
+        return entry.parsed;
+
+    std::istringstream in(source);
+    entry.parsed = parse(in);
+    remember(entry);
+    return entry.parsed;
+}
+
+PTR(Expression) ProgramCache::optimized(const std::string &source) {
+    Entry entry = lookup(source);
+    if (entry.optimized != nullptr)
+        return entry.optimized;
+
+    if (entry.parsed == nullptr) {
+        std::istringstream in(source);
+        entry.parsed = parse(in);
+    }
+    {
+        Tracer::Span span("optimize");
+        entry.optimized = entry.parsed->optimize();
+    }
+    remember(entry);
+    return entry.optimized;
+}
+
+std::string ProgramCache::run(Program::modeT mode, const std::string &source, const std::atomic<bool> *cancel,
+                              long *peakBytes) {
+    if (mode == Program::OptimizeMode) {
+        /* optimizing interprets closed subexpressions, which may not terminate */
+        PTR(Budget) limits = Program::budget(cancel);
+        if (limits == nullptr && peakBytes != nullptr)
+            limits = NEW(Budget)(-1, std::chrono::milliseconds(0));
+        std::string result;
+        {
+            Budget::Scope scope(limits.get());
+            result = optimized(source)->toString();
+        }
+        if (peakBytes != nullptr)
+            *peakBytes = limits->peakBytes();
+        return result;
+    }
+    return Program::evaluate(mode, parsed(source), cancel, peakBytes);
+}
+
+long ProgramCache::hits() {
+    return hitCount;
+}
+
+long ProgramCache::misses() {
+    return missCount;
+}
+
+long ProgramCache::evictions() {
+    return evictionCount;
+}
+
+double ProgramCache::hitRate() {
+    long hitsNow = hitCount;
+    long lookups = hitsNow + missCount;
+    return lookups == 0 ? 0 : (double) hitsNow / lookups;
+}
+
+std::string ProgramCache::stats() {
+    std::ostringstream out;
+    out << "cache_hits " << hits() << "\n";
+    out << "cache_misses " << misses() << "\n";
+    out << "cache_evictions " << evictions() << "\n";
+    out << "cache_hit_rate " << hitRate() << "\n";
+    return out.str();
+}
+
+ProgramCache::Shard &ProgramCache::shardFor(const std::string &source) {
+    return *shards[std::hash<std::string>()(source) % shards.size()];
+}
+
+/**
+ * @return a copy of the cached entry for `source`, or an entry with
+ * no trees on a miss.
+ */
+ProgramCache::Entry ProgramCache::lookup(const std::string &source) {
+    Entry entry;
+    Shard &shard = shardFor(source);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    auto found = shard.index.find(source);
+    if (found == shard.index.end()) {
+        missCount++;
+        entry.source = source;
+        return entry;
+    }
+    hitCount++;
+    shard.recent.splice(shard.recent.begin(), shard.recent, found->second);
+    entry.source = source;
+    entry.parsed = found->second->parsed;
+    entry.optimized = found->second->optimized;
+    return entry;
+}
+
+/**
+ * Stores `entry`, keeping whatever trees another thread may already
+ * have stored for the same source, and evicts the shard's least
+ * recently used entry if that makes the shard too big.
+ */
+void ProgramCache::remember(const Entry &entry) {
+    Shard &shard = shardFor(entry.source);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    auto found = shard.index.find(entry.source);
+    if (found != shard.index.end()) {
+        if (found->second->optimized == nullptr)
+            found->second->optimized = entry.optimized;
+        shard.recent.splice(shard.recent.begin(), shard.recent, found->second);
+        return;
+    }
+
+    shard.recent.push_front(entry);
+    shard.index[entry.source] = shard.recent.begin();
+    if (shard.recent.size() > shardCapacity) {
+        shard.index.erase(shard.recent.back().source);
+        shard.recent.pop_back();
+        evictionCount++;
+    }
+}
+
+TEST_CASE("program cache") {
+    ProgramCache cache(2, 1);
+    CHECK(cache.run(Program::InterpMode, "1 + 2") == "3");
+    CHECK(cache.run(Program::StepMode, "1 + 2") == "3");
+    CHECK(cache.run(Program::OptimizeMode, "1 + 2") == "3");
+    CHECK(cache.parsed("1 + 2") == cache.parsed("1 + 2"));
+    CHECK(cache.misses() == 1);
+    CHECK(cache.hits() == 4);
+
+    CHECK_THROWS(cache.run(Program::InterpMode, "1 +"));
+    CHECK(cache.run(Program::OptimizeMode, "x + 1 + 1") == "(x + 2)");
+    CHECK(cache.run(Program::InterpMode, "4 * 4") == "16");
+    CHECK(cache.evictions() == 1);
+    CHECK(cache.run(Program::InterpMode, "1 + 2") == "3");
+    CHECK(cache.misses() == 5);
+}
+
+TEST_CASE("program cache shared between threads") {
+    ProgramCache cache(64);
+    std::atomic<int> wrong(0);
+    {
+        WorkStealingPool pool(4);
+        for (int i = 0; i < 2000; i++) {
+            pool.submit([&cache, &wrong, i] {
+                int n = i % 100;
+                Program::modeT mode = i % 2 == 0 ? Program::InterpMode : Program::OptimizeMode;
+                if (cache.run(mode, "_let x = " + std::to_string(n) + " _in x * 2") != std::to_string(n * 2))
+                    wrong++;
+            });
+        }
+    }
+    CHECK(wrong == 0);
+    CHECK(cache.hits() + cache.misses() == 2000);
+}
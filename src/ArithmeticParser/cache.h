@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "pointer.h"
+#include "program.h"
+
+class Expression;
+
+/**
+ * A bounded cache from program source text to its parsed and
+ * optimized `Expression`s, for processes that see the same programs
+ * over and over. Entries are spread over independently locked shards
+ * by the hash of their source, and each shard evicts its least
+ * recently used entry when full. Cached trees are never modified
+ * (interpreting and optimizing build new objects), so they are shared
+ * freely between threads.
+ */
+class ProgramCache {
+public:
+    /**
+     * @param capacity maximum number of programs kept.
+     * @param shards number of independently locked shards.
+     */
+    explicit ProgramCache(size_t capacity, int shards = 16);
+
+    /**
+     * @return the parsed form of `source`, parsing it on a miss.
+     * @throws Throws `runtime_error` for parse errors, which are not cached.
+     */
+    PTR(Expression) parsed(const std::string &source);
+
+    /**
+     * @return the optimized form of `source`, optimizing it once per entry.
+     * @throws Throws `runtime_error` for parse and optimization errors.
+     */
+    PTR(Expression) optimized(const std::string &source);
+
+    /**
+     * Like `Program::run`, but with the parse (and for `OptimizeMode`
+     * the optimization) taken from the cache. Evaluation stops early
+     * if `cancel` becomes true; `peakBytes` is as for `Program::evaluate`.
+     */
+    std::string run(Program::modeT mode, const std::string &source, const std::atomic<bool> *cancel = nullptr,
+                    long *peakBytes = nullptr);
+
+    long hits();
+
+    long misses();
+
+    long evictions();
+
+    /**
+     * @return `hits / (hits + misses)`, or 0 before the first lookup.
+     */
+    double hitRate();
+
+    /**
+     * @return the counters above, one `name value` per line.
+     */
+    std::string stats();
+
+private:
+    class Entry {
+    public:
+        std::string source;
+        PTR(Expression) parsed;
+        PTR(Expression) optimized;
+    };
+
+    class Shard {
+    public:
+        std::mutex lock;
+        std::list<Entry> recent; /* most recently used first */
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    };
+
+    size_t shardCapacity;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<long> hitCount;
+    std::atomic<long> missCount;
+    std::atomic<long> evictionCount;
+
+    Shard &shardFor(const std::string &source);
+
+    Entry lookup(const std::string &source);
+
+    void remember(const Entry &entry);
+};
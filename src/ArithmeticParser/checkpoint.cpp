@@ -0,0 +1,550 @@
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "checkpoint.h"
+#include "step.h"
+#include "continuation.h"
+#include "Environment.h"
+#include "expression.hpp"
+#include "value.h"
+#include "parse.h"
+#include "library.h"
+#include "../catch/catch.hpp"
+
+static const std::string magic = "MSDC1";
+
+/* one object of the graph; exactly one of the pointers is set, or none for a null reference */
+class Node {
+public:
+    PTR(Expression) expression;
+    PTR(Value) value;
+    PTR(Environment) environment;
+    PTR(Continuation) continuation;
+
+    const void *address() const {
+        if (expression != nullptr)
+            return expression.get();
+        if (value != nullptr)
+            return value.get();
+        if (environment != nullptr)
+            return environment.get();
+        return continuation.get();
+    }
+};
+
+static Node nodeOf(PTR(Expression) expression) {
+    Node node;
+    node.expression = std::move(expression);
+    return node;
+}
+
+static Node nodeOf(PTR(Value) value) {
+    Node node;
+    node.value = std::move(value);
+    return node;
+}
+
+static Node nodeOf(PTR(Environment) environment) {
+    Node node;
+    node.environment = std::move(environment);
+    return node;
+}
+
+static Node nodeOf(PTR(Continuation) continuation) {
+    Node node;
+    node.continuation = std::move(continuation);
+    return node;
+}
+
+typedef enum {
+    NumberTag = 1,
+    AddTag,
+    MultiplyTag,
+    VariableTag,
+    LetTag,
+    BooleanTag,
+    IfTag,
+    EqualsTag,
+    FunctionTag,
+    CallTag,
+    EmptyEnvTag,
+    ExtendedEnvTag,
+    NumberValueTag,
+    BooleanValueTag,
+    FunctionValueTag,
+    RightThenAddTag,
+    AddContTag,
+    RightThenMultiplyTag,
+    MultiplyContTag,
+    RightThenCompTag,
+    CompContTag,
+    IfBranchTag,
+    LetBodyTag,
+    ArgThenCallTag,
+    CallContTag,
+    TagCount
+} tagT;
+
+/* how many numbers, names and references a record of each kind has */
+static const struct {
+    int numbers;
+    int names;
+    int references;
+} shapes[TagCount] = {
+        {0, 0, 0}, /* unused */
+        {1, 0, 0}, /* NumberTag */
+        {0, 0, 2}, /* AddTag */
+        {0, 0, 2}, /* MultiplyTag */
+        {0, 1, 0}, /* VariableTag */
+        {0, 1, 2}, /* LetTag */
+        {1, 0, 0}, /* BooleanTag */
+        {0, 0, 3}, /* IfTag */
+        {0, 0, 2}, /* EqualsTag */
+        {0, 1, 1}, /* FunctionTag */
+        {0, 0, 2}, /* CallTag */
+        {0, 0, 0}, /* EmptyEnvTag */
+        {0, 1, 2}, /* ExtendedEnvTag */
+        {1, 0, 0}, /* NumberValueTag */
+        {1, 0, 0}, /* BooleanValueTag */
+        {0, 1, 2}, /* FunctionValueTag */
+        {0, 0, 3}, /* RightThenAddTag */
+        {0, 0, 2}, /* AddContTag */
+        {0, 0, 3}, /* RightThenMultiplyTag */
+        {0, 0, 2}, /* MultiplyContTag */
+        {0, 0, 3}, /* RightThenCompTag */
+        {0, 0, 2}, /* CompContTag */
+        {0, 0, 4}, /* IfBranchTag */
+        {0, 1, 3}, /* LetBodyTag */
+        {0, 0, 3}, /* ArgThenCallTag */
+        {0, 0, 2}, /* CallContTag */
+};
+
+/* an object's kind, plain fields and references, in one shape for all kinds */
+class Record {
+public:
+    tagT tag;
+    std::vector<long> numbers;
+    std::vector<std::string> names;
+    std::vector<Node> references;
+};
+
+static Record describe(const Node &node) {
+    Record r;
+    if (node.expression != nullptr) {
+        PTR(Expression) e = node.expression;
+        if (PTR(NumberExpression) number = CAST(NumberExpression)(e)) {
+            r.tag = NumberTag;
+            r.numbers = {number->primitiveValue};
+        } else if (PTR(AddExpression) add = CAST(AddExpression)(e)) {
+            r.tag = AddTag;
+            r.references = {nodeOf(add->leftExpression), nodeOf(add->rightExpression)};
+        } else if (PTR(MultiplyExpression) multiply = CAST(MultiplyExpression)(e)) {
+            r.tag = MultiplyTag;
+            r.references = {nodeOf(multiply->leftExpression), nodeOf(multiply->rightExpression)};
+        } else if (PTR(VariableExpression) variable = CAST(VariableExpression)(e)) {
+            r.tag = VariableTag;
+            r.names = {variable->name};
+        } else if (PTR(LetExpression) let = CAST(LetExpression)(e)) {
+            r.tag = LetTag;
+            r.names = {let->var};
+            r.references = {nodeOf(let->rhs), nodeOf(let->body)};
+        } else if (PTR(BooleanExpression) boolean = CAST(BooleanExpression)(e)) {
+            r.tag = BooleanTag;
+            r.numbers = {boolean->truthValue};
+        } else if (PTR(IfExpression) ifExpression = CAST(IfExpression)(e)) {
+            r.tag = IfTag;
+            r.references = {nodeOf(ifExpression->testPart), nodeOf(ifExpression->thenResult),
+                            nodeOf(ifExpression->elseResult)};
+        } else if (PTR(EqualsExpression) equals = CAST(EqualsExpression)(e)) {
+            r.tag = EqualsTag;
+            r.references = {nodeOf(equals->leftExpression), nodeOf(equals->rightExpression)};
+        } else if (PTR(FunctionExpression) function = CAST(FunctionExpression)(e)) {
+            r.tag = FunctionTag;
+            r.names = {function->formalArg};
+            r.references = {nodeOf(function->body)};
+        } else if (PTR(CallExpression) call = CAST(CallExpression)(e)) {
+            r.tag = CallTag;
+            r.references = {nodeOf(call->toBeCalled), nodeOf(call->actualArg)};
+        } else {
+            throw std::runtime_error("cannot checkpoint this expression");
+        }
+    } else if (node.environment != nullptr) {
+        PTR(Environment) env = node.environment;
+        if (CAST(EmptyEnv)(env) != nullptr) {
+            r.tag = EmptyEnvTag;
+        } else if (PTR(ExtendedEnv) extended = CAST(ExtendedEnv)(env)) {
+            r.tag = ExtendedEnvTag;
+            r.names = {extended->name};
+            r.references = {nodeOf(extended->val), nodeOf(extended->rest)};
+        } else {
+            throw std::runtime_error("cannot checkpoint this environment");
+        }
+    } else if (node.value != nullptr) {
+        PTR(Value) val = node.value;
+        if (PTR(NumberValue) number = CAST(NumberValue)(val)) {
+            r.tag = NumberValueTag;
+            r.numbers = {number->primitiveValue};
+        } else if (PTR(BooleanValue) boolean = CAST(BooleanValue)(val)) {
+            r.tag = BooleanValueTag;
+            r.numbers = {boolean->primitiveValue};
+        } else if (PTR(FunctionValue) function = CAST(FunctionValue)(val)) {
+            r.tag = FunctionValueTag;
+            r.names = {function->formalArg};
+            r.references = {nodeOf(function->body), nodeOf(function->env)};
+        } else {
+            throw std::runtime_error("cannot checkpoint this value");
+        }
+    } else {
+        PTR(Continuation) cont = node.continuation;
+        if (PTR(RightThenAddContinuation) k = CAST(RightThenAddContinuation)(cont)) {
+            r.tag = RightThenAddTag;
+            r.references = {nodeOf(k->rhs), nodeOf(k->env), nodeOf(k->rest)};
+        } else if (PTR(AddContinuation) k = CAST(AddContinuation)(cont)) {
+            r.tag = AddContTag;
+            r.references = {nodeOf(k->lhsVal), nodeOf(k->rest)};
+        } else if (PTR(RightThenMultiplyContinuation) k = CAST(RightThenMultiplyContinuation)(cont)) {
+            r.tag = RightThenMultiplyTag;
+            r.references = {nodeOf(k->rhs), nodeOf(k->env), nodeOf(k->rest)};
+        } else if (PTR(MultiplyContinuation) k = CAST(MultiplyContinuation)(cont)) {
+            r.tag = MultiplyContTag;
+            r.references = {nodeOf(k->lhsVal), nodeOf(k->rest)};
+        } else if (PTR(RightThenCompContinuation) k = CAST(RightThenCompContinuation)(cont)) {
+            r.tag = RightThenCompTag;
+            r.references = {nodeOf(k->rhs), nodeOf(k->env), nodeOf(k->rest)};
+        } else if (PTR(CompContinuation) k = CAST(CompContinuation)(cont)) {
+            r.tag = CompContTag;
+            r.references = {nodeOf(k->lhsVal), nodeOf(k->rest)};
+        } else if (PTR(IfBranchCont) k = CAST(IfBranchCont)(cont)) {
+            r.tag = IfBranchTag;
+            r.references = {nodeOf(k->thenPart), nodeOf(k->elsePart), nodeOf(k->env), nodeOf(k->rest)};
+        } else if (PTR(LetBodyCont) k = CAST(LetBodyCont)(cont)) {
+            r.tag = LetBodyTag;
+            r.names = {k->var};
+            r.references = {nodeOf(k->body), nodeOf(k->env), nodeOf(k->rest)};
+        } else if (PTR(ArgThenCallCont) k = CAST(ArgThenCallCont)(cont)) {
+            r.tag = ArgThenCallTag;
+            r.references = {nodeOf(k->actualArg), nodeOf(k->env), nodeOf(k->rest)};
+        } else if (PTR(CallCont) k = CAST(CallCont)(cont)) {
+            r.tag = CallContTag;
+            r.references = {nodeOf(k->toBeCalledVal), nodeOf(k->rest)};
+        } else {
+            throw std::runtime_error("cannot checkpoint this continuation");
+        }
+    }
+    return r;
+}
+
+static void badCheckpoint() {
+    throw std::runtime_error("bad checkpoint");
+}
+
+static PTR(Expression) expressionAt(const Record &r, int i) {
+    if (r.references[i].expression == nullptr)
+        badCheckpoint();
+    return r.references[i].expression;
+}
+
+static PTR(Value) valueAt(const Record &r, int i) {
+    if (r.references[i].value == nullptr)
+        badCheckpoint();
+    return r.references[i].value;
+}
+
+static PTR(Environment) environmentAt(const Record &r, int i) {
+    if (r.references[i].environment == nullptr)
+        badCheckpoint();
+    return r.references[i].environment;
+}
+
+/* a continuation reference may be null, which is `Continuation::done` */
+static PTR(Continuation) continuationAt(const Record &r, int i) {
+    if (r.references[i].address() != nullptr && r.references[i].continuation == nullptr)
+        badCheckpoint();
+    return r.references[i].continuation;
+}
+
+static Node build(const Record &r) {
+    switch (r.tag) {
+        case NumberTag:
+            return nodeOf(PTR(Expression)(NEW(NumberExpression)(static_cast<int>(r.numbers[0]))));
+        case AddTag:
+            return nodeOf(PTR(Expression)(NEW(AddExpression)(expressionAt(r, 0), expressionAt(r, 1))));
+        case MultiplyTag:
+            return nodeOf(PTR(Expression)(NEW(MultiplyExpression)(expressionAt(r, 0), expressionAt(r, 1))));
+        case VariableTag:
+            return nodeOf(PTR(Expression)(NEW(VariableExpression)(r.names[0])));
+        case LetTag:
+            return nodeOf(PTR(Expression)(NEW(LetExpression)(r.names[0], expressionAt(r, 0), expressionAt(r, 1))));
+        case BooleanTag:
+            return nodeOf(PTR(Expression)(NEW(BooleanExpression)(r.numbers[0] != 0)));
+        case IfTag:
+            return nodeOf(PTR(Expression)(NEW(IfExpression)(expressionAt(r, 0), expressionAt(r, 1),
+                                                            expressionAt(r, 2))));
+        case EqualsTag:
+            return nodeOf(PTR(Expression)(NEW(EqualsExpression)(expressionAt(r, 0), expressionAt(r, 1))));
+        case FunctionTag:
+            return nodeOf(PTR(Expression)(NEW(FunctionExpression)(r.names[0], expressionAt(r, 0))));
+        case CallTag:
+            return nodeOf(PTR(Expression)(NEW(CallExpression)(expressionAt(r, 0), expressionAt(r, 1))));
+        case EmptyEnvTag:
+            return nodeOf(Environment::empty());
+        case ExtendedEnvTag:
+            return nodeOf(PTR(Environment)(NEW(ExtendedEnv)(r.names[0], valueAt(r, 0), environmentAt(r, 1))));
+        case NumberValueTag:
+            return nodeOf(PTR(Value)(NEW(NumberValue)(static_cast<int>(r.numbers[0]))));
+        case BooleanValueTag:
+            return nodeOf(PTR(Value)(NEW(BooleanValue)(r.numbers[0] != 0)));
+        case FunctionValueTag:
+            return nodeOf(PTR(Value)(NEW(FunctionValue)(r.names[0], expressionAt(r, 0), environmentAt(r, 1))));
+        case RightThenAddTag:
+            return nodeOf(PTR(Continuation)(NEW(RightThenAddContinuation)(expressionAt(r, 0), environmentAt(r, 1),
+                                                                          continuationAt(r, 2))));
+        case AddContTag:
+            return nodeOf(PTR(Continuation)(NEW(AddContinuation)(valueAt(r, 0), continuationAt(r, 1))));
+        case RightThenMultiplyTag:
+            return nodeOf(PTR(Continuation)(NEW(RightThenMultiplyContinuation)(expressionAt(r, 0),
+                                                                               environmentAt(r, 1),
+                                                                               continuationAt(r, 2))));
+        case MultiplyContTag:
+            return nodeOf(PTR(Continuation)(NEW(MultiplyContinuation)(valueAt(r, 0), continuationAt(r, 1))));
+        case RightThenCompTag:
+            return nodeOf(PTR(Continuation)(NEW(RightThenCompContinuation)(expressionAt(r, 0), environmentAt(r, 1),
+                                                                           continuationAt(r, 2))));
+        case CompContTag:
+            return nodeOf(PTR(Continuation)(NEW(CompContinuation)(valueAt(r, 0), continuationAt(r, 1))));
+        case IfBranchTag:
+            return nodeOf(PTR(Continuation)(NEW(IfBranchCont)(expressionAt(r, 0), expressionAt(r, 1),
+                                                              environmentAt(r, 2), continuationAt(r, 3))));
+        case LetBodyTag:
+            return nodeOf(PTR(Continuation)(NEW(LetBodyCont)(r.names[0], expressionAt(r, 0), environmentAt(r, 1),
+                                                             continuationAt(r, 2))));
+        case ArgThenCallTag:
+            return nodeOf(PTR(Continuation)(NEW(ArgThenCallCont)(expressionAt(r, 0), environmentAt(r, 1),
+                                                                 continuationAt(r, 2))));
+        case CallContTag:
+            return nodeOf(PTR(Continuation)(NEW(CallCont)(valueAt(r, 0), continuationAt(r, 1))));
+        default:
+            badCheckpoint();
+            return Node();
+    }
+}
+
+/* numbers are written as base-128 varints, signed ones zigzag encoded first */
+static void writeNumber(std::string &out, unsigned long number) {
+    while (number >= 0x80) {
+        out.push_back(static_cast<char>((number & 0x7f) | 0x80));
+        number >>= 7;
+    }
+    out.push_back(static_cast<char>(number));
+}
+
+static void writeSigned(std::string &out, long number) {
+    writeNumber(out, (static_cast<unsigned long>(number) << 1) ^ static_cast<unsigned long>(number >> 63));
+}
+
+class CheckpointReader {
+public:
+    explicit CheckpointReader(const std::string &data) : data(data), position(0) {}
+
+    unsigned long number() {
+        unsigned long result = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            unsigned char byte = nextByte();
+            result |= static_cast<unsigned long>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+                return result;
+        }
+        badCheckpoint();
+        return 0;
+    }
+
+    long signedNumber() {
+        unsigned long zigzag = number();
+        return static_cast<long>(zigzag >> 1) ^ -static_cast<long>(zigzag & 1);
+    }
+
+    std::string name() {
+        unsigned long length = number();
+        if (length > data.size() - position)
+            badCheckpoint();
+        std::string result = data.substr(position, length);
+        position += length;
+        return result;
+    }
+
+    unsigned char nextByte() {
+        if (position >= data.size())
+            badCheckpoint();
+        return static_cast<unsigned char>(data[position++]);
+    }
+
+    bool atEnd() const {
+        return position == data.size();
+    }
+
+private:
+    const std::string &data;
+    size_t position;
+};
+
+/**
+ * Writes every object reachable from the registers, each after all
+ * the objects it refers to, then the registers themselves.
+ */
+std::string Checkpoint::save() {
+    Node roots[] = {nodeOf(Step::expr), nodeOf(Step::env), nodeOf(Step::val), nodeOf(Step::cont)};
+    std::unordered_map<const void *, unsigned long> ids;
+    std::string records;
+
+    /* an object is expanded (its references queued) before it is written */
+    std::vector<std::pair<Node, bool>> pending;
+    for (const Node &root : roots) {
+        if (root.address() != nullptr)
+            pending.emplace_back(root, false);
+    }
+    while (!pending.empty()) {
+        Node node = pending.back().first;
+        bool expanded = pending.back().second;
+        pending.pop_back();
+        if (ids.count(node.address()) > 0)
+            continue;
+
+        Record r = describe(node);
+        if (!expanded) {
+            pending.emplace_back(node, true);
+            for (const Node &reference : r.references) {
+                if (reference.address() != nullptr && ids.count(reference.address()) == 0)
+                    pending.emplace_back(reference, false);
+            }
+            continue;
+        }
+
+        records.push_back(static_cast<char>(r.tag));
+        for (long number : r.numbers)
+            writeSigned(records, number);
+        for (const std::string &name : r.names) {
+            writeNumber(records, name.size());
+            records += name;
+        }
+        for (const Node &reference : r.references)
+            writeNumber(records, reference.address() == nullptr ? 0 : ids[reference.address()]);
+        unsigned long id = ids.size() + 1;
+        ids[node.address()] = id;
+    }
+
+    std::string out = magic;
+    writeNumber(out, ids.size());
+    out += records;
+    out.push_back(static_cast<char>(Step::mode));
+    for (const Node &root : roots)
+        writeNumber(out, root.address() == nullptr ? 0 : ids[root.address()]);
+    return out;
+}
+
+void Checkpoint::restore(const std::string &data) {
+    if (data.compare(0, magic.size(), magic) != 0)
+        badCheckpoint();
+    CheckpointReader in(data);
+    for (size_t i = 0; i < magic.size(); i++)
+        in.nextByte();
+
+    unsigned long count = in.number();
+    if (count > data.size())
+        badCheckpoint();
+    std::vector<Node> table;
+    table.reserve(count);
+    for (unsigned long i = 0; i < count; i++) {
+        Record r;
+        unsigned char tag = in.nextByte();
+        if (tag == 0 || tag >= TagCount)
+            badCheckpoint();
+        r.tag = static_cast<tagT>(tag);
+        for (int j = 0; j < shapes[tag].numbers; j++)
+            r.numbers.push_back(in.signedNumber());
+        for (int j = 0; j < shapes[tag].names; j++)
+            r.names.push_back(in.name());
+        for (int j = 0; j < shapes[tag].references; j++) {
+            unsigned long id = in.number();
+            if (id > table.size())
+                badCheckpoint();
+            r.references.push_back(id == 0 ? Node() : table[id - 1]);
+        }
+        table.push_back(build(r));
+    }
+
+    unsigned char mode = in.nextByte();
+    if (mode != Step::InterpMode && mode != Step::ContinueMode)
+        badCheckpoint();
+    Node roots[4];
+    for (Node &root : roots) {
+        unsigned long id = in.number();
+        if (id > table.size())
+            badCheckpoint();
+        root = id == 0 ? Node() : table[id - 1];
+    }
+    if (!in.atEnd())
+        badCheckpoint();
+    if ((roots[0].address() != nullptr && roots[0].expression == nullptr)
+        || (roots[1].address() != nullptr && roots[1].environment == nullptr)
+        || (roots[2].address() != nullptr && roots[2].value == nullptr)
+        || (roots[3].address() != nullptr && roots[3].continuation == nullptr))
+        badCheckpoint();
+
+    Step::mode = static_cast<Step::modeT>(mode);
+    Step::expr = roots[0].expression;
+    Step::env = roots[1].environment;
+    Step::val = roots[2].value;
+    Step::cont = roots[3].continuation;
+}
+
+TEST_CASE("checkpoints") {
+    PTR(Expression) count = parseSource("_let count = _fun(count) _fun(n)\n"
+                                        "_if n == 0 _then 0 _else 1 + count(count)(n + -1)\n"
+                                        "_in count(count)(20000)");
+    Step::start(count, Environment::empty());
+    REQUIRE(!Step::run(100000));
+    std::string saved = Checkpoint::save();
+    CHECK(saved.compare(0, 5, "MSDC1") == 0);
+
+    /* finish the original, then resume the copy on another thread */
+    CHECK(!Step::run(1000));
+    REQUIRE(Step::run(-1));
+    CHECK(Step::val->toString() == "20000");
+    std::string resumed;
+    std::thread other([&saved, &resumed] {
+        Checkpoint::restore(saved);
+        Step::run(-1);
+        resumed = Step::val->toString();
+    });
+    other.join();
+    CHECK(resumed == "20000");
+
+    /* every pending addition shares one `count` closure */
+    Checkpoint::restore(saved);
+    CHECK(Checkpoint::save() == saved);
+    CHECK(saved.size() < 20 * 20000);
+
+    SECTION("sharing") {
+        PTR(Environment) env = Bindings().bind("x", 1).bind("y", 2).environment();
+        Step::start(parseSource("x + y"), env);
+        Step::run(1);
+        Checkpoint::restore(Checkpoint::save());
+        PTR(RightThenAddContinuation) pending = CAST(RightThenAddContinuation)(Step::cont);
+        REQUIRE(pending != nullptr);
+        CHECK(pending->env == Step::env);
+        CHECK(Step::run(-1));
+        CHECK(Step::val->toString() == "3");
+    }
+
+    SECTION("bad data") {
+        CHECK_THROWS_WITH(Checkpoint::restore(""), "bad checkpoint");
+        CHECK_THROWS_WITH(Checkpoint::restore(saved.substr(0, saved.size() / 2)), "bad checkpoint");
+        CHECK_THROWS_WITH(Checkpoint::restore(saved + "x"), "bad checkpoint");
+        Step::start(parseSource("1"), Environment::empty());
+        std::string wrongKind = Checkpoint::save();
+        wrongKind[magic.size() + 1] = static_cast<char>(TagCount);
+        CHECK_THROWS_WITH(Checkpoint::restore(wrongKind), "bad checkpoint");
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+
+/**
+ * Snapshots of a paused step evaluation. All of step mode's state is
+ * in this thread's `Step` registers and the expressions, environments,
+ * values and continuations they reach, so saving that graph is enough
+ * to resume the evaluation later, on another thread or in another
+ * process.
+ *
+ * A checkpoint is a compact binary string. Every object in the graph
+ * is written once and referred to by number, so objects shared in the
+ * running evaluation (an environment captured by many continuations,
+ * say) are still shared after `restore`. Nothing is written or read
+ * recursively, so arbitrarily deep continuation chains are fine.
+ */
+class Checkpoint {
+public:
+    /**
+     * @return this thread's `Step` registers and everything they reach,
+     * typically saved after `Step::run` returned without finishing.
+     * @throws Throws `runtime_error` if the graph holds an object of a
+     * kind that cannot be saved.
+     */
+    static std::string save();
+
+    /**
+     * Sets this thread's `Step` registers from `data`, which `save`
+     * produced, so that `Step::run` continues the saved evaluation.
+     * @throws Throws `runtime_error` if `data` is not a checkpoint.
+     */
+    static void restore(const std::string &data);
+};
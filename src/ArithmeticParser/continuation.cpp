@@ -4,10 +4,17 @@
 
 #include "value.h"
 #include "Environment.h"
+#include "stats.h"
+#include "trace.h"
+
+Continuation::~Continuation() {
+    STAT_CONTINUATION_FREED();
+}
 
 RightThenAddContinuation::RightThenAddContinuation(PTR(Expression) rhs,
                                                    PTR(Environment) env,
                                                    PTR(Continuation) rest) {
+    STAT_CONTINUATION_MADE(RightThenAddKind);
     this->rhs = std::move(rhs);
     this->env = std::move(env);
     this->rest = std::move(rest);
@@ -24,6 +31,7 @@ void RightThenAddContinuation::stepContinue() {
 
 AddContinuation::AddContinuation(PTR(Value) lhsVal,
                                  PTR(Continuation) rest) {
+    STAT_CONTINUATION_MADE(AddContKind);
     this->lhsVal = std::move(lhsVal);
     this->rest = std::move(rest);
 
@@ -39,6 +47,7 @@ void AddContinuation::stepContinue() {
 RightThenMultiplyContinuation::RightThenMultiplyContinuation(PTR(Expression) rhs,
                                                              PTR(Environment) env,
                                                              PTR(Continuation) rest) {
+    STAT_CONTINUATION_MADE(RightThenMultiplyKind);
     this->rhs = std::move(rhs);
     this->env = std::move(env);
     this->rest = std::move(rest);
@@ -54,6 +63,7 @@ void RightThenMultiplyContinuation::stepContinue() {
 
 MultiplyContinuation::MultiplyContinuation(PTR(Value) lhsVal,
                                            PTR(Continuation) rest) {
+    STAT_CONTINUATION_MADE(MultiplyContKind);
     this->lhsVal = std::move(lhsVal);
     this->rest = std::move(rest);
 
@@ -82,6 +92,7 @@ IfBranchCont::IfBranchCont(PTR(Expression) thenPart,
                            PTR(Expression) elsePart,
                            PTR(Environment) env,
                            PTR(Continuation) rest) {
+    STAT_CONTINUATION_MADE(IfBranchKind);
     this->thenPart = std::move(thenPart);
     this->elsePart = std::move(elsePart);
     this->env = std::move(env);
@@ -103,6 +114,7 @@ LetBodyCont::LetBodyCont(std::string var,
                          PTR(Expression) body,
                          PTR(Environment) env,
                          PTR(Continuation) rest) {
+    STAT_CONTINUATION_MADE(LetBodyKind);
     this->var = std::move(var);
     this->body = std::move(body);
     this->env = std::move(env);
@@ -113,6 +125,7 @@ LetBodyCont::LetBodyCont(std::string var,
 ArgThenCallCont::ArgThenCallCont(PTR(Expression) actualArg,
                                  PTR(Environment) env,
                                  PTR(Continuation) rest) {
+    STAT_CONTINUATION_MADE(ArgThenCallKind);
     this->actualArg = std::move(actualArg);
     this->env = std::move(env);
     this->rest = std::move(rest);
@@ -127,19 +140,28 @@ void ArgThenCallCont::stepContinue() {
 
 CallCont::CallCont(PTR(Value) toBeCalledVal,
                    PTR(Continuation) rest) {
+    STAT_CONTINUATION_MADE(CallContKind);
     this->toBeCalledVal = std::move(toBeCalledVal);
     this->rest = std::move(rest);
 }
 
 void CallCont::stepContinue() {
+    if (Tracer::sampleCall())
+        Tracer::instant("step call");
     Step::mode = Step::ContinueMode;
     PTR(FunctionValue) functionValueToBeCalledVal = CAST(FunctionValue)(toBeCalledVal);
+    if (functionValueToBeCalledVal == nullptr) {
+        /* throws the same error `interpret` reports for calling a non-function */
+        toBeCalledVal->call(Step::val);
+        return;
+    }
     functionValueToBeCalledVal->callStep(Step::val, rest);
 }
 
 RightThenCompContinuation::RightThenCompContinuation(PTR(Expression) rhs,
                                                      PTR(Environment) env,
                                                      PTR(Continuation) rest) {
+    STAT_CONTINUATION_MADE(RightThenCompKind);
     this->rhs = std::move(rhs);
     this->env = std::move(env);
     this->rest = std::move(rest);
@@ -156,6 +178,7 @@ void RightThenCompContinuation::stepContinue() {
 
 CompContinuation::CompContinuation(PTR(Value) lhsVal,
                                    PTR(Continuation) rest) {
+    STAT_CONTINUATION_MADE(CompContKind);
     this->lhsVal = std::move(lhsVal);
     this->rest = std::move(rest);
 
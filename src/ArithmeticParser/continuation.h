@@ -25,6 +25,8 @@ public:
        (i.e., must not be used by this method). */
     virtual void stepContinue() = 0;
 
+    virtual ~Continuation();
+
     static PTR(Continuation) done;
 };
 
@@ -135,9 +137,10 @@ public:
 };
 
 class CallCont : public Continuation {
+public:
     PTR(Value) toBeCalledVal;
     PTR(Continuation) rest;
-public:
+
     CallCont(PTR(Value) toBeCalledVal, PTR(Continuation) rest);
 
     void stepContinue() override;
@@ -0,0 +1,171 @@
+#include <sstream>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "cost.h"
+#include "expression.hpp"
+#include "parse.h"
+#include "../catch/catch.hpp"
+
+static bool isSelfApplication(const PTR(CallExpression) &call) {
+    PTR(VariableExpression) function = CAST(VariableExpression)(call->toBeCalled);
+    PTR(VariableExpression) argument = CAST(VariableExpression)(call->actualArg);
+    return function != nullptr && argument != nullptr && function->name == argument->name;
+}
+
+/**
+ * Puts `e`'s subexpressions in `children`.
+ * @return how many there are.
+ */
+static int childrenOf(const PTR(Expression) &e, PTR(Expression) children[3]) {
+    if (PTR(AddExpression) add = CAST(AddExpression)(e)) {
+        children[0] = add->leftExpression;
+        children[1] = add->rightExpression;
+        return 2;
+    }
+    if (PTR(MultiplyExpression) multiply = CAST(MultiplyExpression)(e)) {
+        children[0] = multiply->leftExpression;
+        children[1] = multiply->rightExpression;
+        return 2;
+    }
+    if (PTR(EqualsExpression) equals = CAST(EqualsExpression)(e)) {
+        children[0] = equals->leftExpression;
+        children[1] = equals->rightExpression;
+        return 2;
+    }
+    if (PTR(CallExpression) call = CAST(CallExpression)(e)) {
+        children[0] = call->toBeCalled;
+        children[1] = call->actualArg;
+        return 2;
+    }
+    if (PTR(LetExpression) let = CAST(LetExpression)(e)) {
+        children[0] = let->rhs;
+        children[1] = let->body;
+        return 2;
+    }
+    if (PTR(IfExpression) ifExpression = CAST(IfExpression)(e)) {
+        children[0] = ifExpression->testPart;
+        children[1] = ifExpression->thenResult;
+        children[2] = ifExpression->elseResult;
+        return 3;
+    }
+    if (PTR(FunctionExpression) function = CAST(FunctionExpression)(e)) {
+        children[0] = function->body;
+        return 1;
+    }
+    return 0;
+}
+
+/* a finished subtree: its call depth and its self-applications not inside a nested function */
+class SubtreeCost {
+public:
+    int depth;
+    int selfCalls;
+};
+
+/**
+ * Walks the tree in post-order. Each finished node pushes its
+ * `SubtreeCost`, and a parent pops those of its children.
+ */
+CostEstimate::CostEstimate(const PTR(Expression) &e) {
+    nodes = 0;
+    callDepth = 0;
+    selfApplications = 0;
+    mostSelfApplications = 0;
+
+    std::vector<SubtreeCost> finished;
+    std::vector<std::pair<PTR(Expression), bool>> pending;
+    PTR(Expression) children[3];
+    pending.emplace_back(e, false);
+    while (!pending.empty()) {
+        PTR(Expression) node = std::move(pending.back().first);
+        bool childrenDone = pending.back().second;
+        pending.pop_back();
+
+        int count = childrenOf(node, children);
+        if (!childrenDone) {
+            pending.emplace_back(node, true);
+            for (int i = count - 1; i >= 0; i--)
+                pending.emplace_back(std::move(children[i]), false);
+            continue;
+        }
+
+        SubtreeCost cost = {0, 0};
+        for (int i = 0; i < count; i++) {
+            cost.depth = std::max(cost.depth, finished.back().depth);
+            cost.selfCalls += finished.back().selfCalls;
+            finished.pop_back();
+        }
+
+        if (PTR(CallExpression) call = CAST(CallExpression)(node)) {
+            cost.depth++;
+            if (isSelfApplication(call)) {
+                cost.selfCalls++;
+                selfApplications++;
+            }
+        } else if (CAST(FunctionExpression)(node) != nullptr) {
+            /* a function body ends the function's self-applications */
+            mostSelfApplications = std::max(mostSelfApplications, cost.selfCalls);
+            cost.selfCalls = 0;
+        }
+        nodes++;
+        callDepth = std::max(callDepth, cost.depth);
+        finished.push_back(cost);
+    }
+}
+
+bool CostEstimate::recursive() const {
+    return mostSelfApplications > 0;
+}
+
+bool CostEstimate::exponential() const {
+    return mostSelfApplications > 1;
+}
+
+double CostEstimate::cost() const {
+    if (exponential())
+        return nodes * 1e6;
+    if (recursive())
+        return nodes * 1e3;
+    return nodes;
+}
+
+Program::modeT CostEstimate::engine() const {
+    return recursive() && !exponential() ? Program::StepMode : Program::InterpMode;
+}
+
+[[maybe_unused]] static CostEstimate estimate(const std::string &source) {
+    std::istringstream in(source);
+    return CostEstimate(parse(in));
+}
+
+TEST_CASE("cost estimates") {
+    [[maybe_unused]] CostEstimate arithmetic = estimate("_let x = 2 _in x * (x + 1)");
+    CHECK(arithmetic.nodes == 7);
+    CHECK(arithmetic.callDepth == 0);
+    CHECK(!arithmetic.recursive());
+    CHECK(arithmetic.cost() == 7);
+    CHECK(arithmetic.engine() == Program::InterpMode);
+
+    [[maybe_unused]] CostEstimate count = estimate("_let count = _fun(count) _fun(n)\n"
+                                                   "_if n == 0 _then 0 _else 1 + count(count)(n + -1)\n"
+                                                   "_in count(count)(10)");
+    CHECK(count.selfApplications == 2);
+    CHECK(count.mostSelfApplications == 1);
+    CHECK(count.callDepth == 2);
+    CHECK(count.recursive());
+    CHECK(!count.exponential());
+    CHECK(count.engine() == Program::StepMode);
+
+    [[maybe_unused]] CostEstimate fib = estimate("_let fib = _fun (fib) _fun (n)\n"
+                                                 "_if n == 0 _then 0 _else _if n == 1 _then 1\n"
+                                                 "_else fib(fib)(n + -1) + fib(fib)(n + -2)\n"
+                                                 "_in fib(fib)(20)");
+    CHECK(fib.exponential());
+    CHECK(fib.engine() == Program::InterpMode);
+    CHECK(fib.cost() > count.cost());
+    CHECK(count.cost() > arithmetic.cost());
+
+    CHECK(estimate("f(g)(h(x))").callDepth == 2);
+    CHECK(!estimate("_fun (f) f(g)").recursive());
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "pointer.h"
+#include "program.h"
+
+class Expression;
+
+/**
+ * A static estimate of how much work evaluating a program takes,
+ * worked out from its parsed tree alone.
+ *
+ * MSDScript can only loop by self-application (`f(f)`), so a program
+ * without any is evaluated in time linear in its size. A function
+ * whose body applies a variable to itself once recurses linearly
+ * (like `count` in the tests); one that does so twice or more, like
+ * `fib`, usually takes exponential time. The analysis is a heuristic:
+ * it cannot know how deep a recursion goes, only that there is one.
+ */
+class CostEstimate {
+public:
+    long nodes;                /* expressions in the tree */
+    int callDepth;             /* most calls nested inside one another */
+    int selfApplications;      /* `f(f)` calls anywhere in the tree */
+    int mostSelfApplications;  /* most `f(f)` calls directly in one function body */
+
+    /**
+     * Analyses `e` without recursion, so deep trees are fine.
+     */
+    explicit CostEstimate(const PTR(Expression) &e);
+
+    bool recursive() const;
+
+    bool exponential() const;
+
+    /**
+     * @return relative evaluation cost: the node count, scaled by 10^3
+     * for a linear recursion and by 10^6 for an exponential one.
+     */
+    double cost() const;
+
+    /**
+     * @return the engine to evaluate the program with: step mode for a
+     * linear recursion, which may be too deep for the native stack,
+     * and the faster `interpret` otherwise.
+     */
+    Program::modeT engine() const;
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include "pointer.h"
 #include "value.h"
 #include "step.h"
@@ -10,6 +11,8 @@ class Expression;
 
 class Expression ENABLE_THIS(Expression) {
 public:
+    virtual ~Expression() = default;
+
     virtual bool equals(PTR(Expression) expression) = 0;
 
     virtual PTR(Value) interpret(PTR(Environment) environment) = 0;
@@ -35,6 +38,14 @@ public:
      */
     virtual void stepInterpret() = 0;
 
+protected:
+    /**
+     * Drops this expression's reference to `child`. Any subtree that
+     * goes with it is destroyed from an explicit worklist rather than
+     * by nested destructors, so tearing down a very deep tree (such as
+     * a long `+` chain) needs only bounded native stack.
+     */
+    static void release(PTR(Expression) &child);
 };
 
 class NumberExpression : public Expression {
@@ -65,6 +76,8 @@ public:
 
     explicit AddExpression(PTR(Expression) leftExpression, PTR(Expression) rightExpression);
 
+    ~AddExpression() override;
+
     bool equals(PTR(Expression) expression) override;
 
     PTR(Value) interpret(PTR(Environment) environment) override;
@@ -87,6 +100,8 @@ public:
 
     explicit MultiplyExpression(PTR(Expression) leftExpression, PTR(Expression) rightExpression);
 
+    ~MultiplyExpression() override;
+
     bool equals(PTR(Expression) expression) override;
 
     PTR(Value) interpret(PTR(Environment) environment) override;
@@ -131,6 +146,8 @@ public:
 
     explicit LetExpression(std::string var, PTR(Expression) rhs, PTR(Expression) body);
 
+    ~LetExpression() override;
+
     bool equals(PTR(Expression) pExpression) override;
 
     PTR(Value) interpret(PTR(Environment) environment) override;
@@ -175,6 +192,8 @@ public:
 
     IfExpression(PTR(Expression) ifCondition, PTR(Expression) thenResult, PTR(Expression) elseResult);
 
+    ~IfExpression() override;
+
     bool equals(PTR(Expression) expression) override;
 
     PTR(Value) interpret(PTR(Environment) environment) override;
@@ -197,6 +216,8 @@ public:
 
     EqualsExpression(PTR(Expression) leftExpression, PTR(Expression) rightExpression);
 
+    ~EqualsExpression() override;
+
     bool equals(PTR(Expression) expression) override;
 
     PTR(Value) interpret(PTR(Environment) environment) override;
@@ -219,6 +240,8 @@ public:
 
     FunctionExpression(std::string formalArg, PTR(Expression) body);
 
+    ~FunctionExpression() override;
+
     bool equals(PTR(Expression) expression) override;
 
     PTR(Value) interpret(PTR(Environment) env) override;
@@ -238,9 +261,12 @@ class CallExpression : public Expression {
 public:
     PTR(Expression) toBeCalled;
     PTR(Expression) actualArg;
+    std::atomic<int> profileSite; /* the `Profiler`'s name for this call site, or 0 before it has one */
 
     CallExpression(PTR(Expression) functionExpression, PTR(Expression) argumentExpression);
 
+    ~CallExpression() override;
+
     bool equals(PTR(Expression) expression) override;
 
     PTR(Value) interpret(PTR(Environment) environment) override;
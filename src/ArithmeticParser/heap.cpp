@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "heap.h"
+#include "program.h"
+#include "parse.h"
+#include "../catch/catch.hpp"
+
+std::atomic<bool> HeapProfile::enabled(false);
+
+/* every type made with `NEW` so far, in the order first made */
+static std::mutex typesLock;
+static std::vector<HeapProfile::TypeCounts *> types;
+
+static std::atomic<long> liveBytes(0);
+
+static std::mutex timelineLock;
+static std::condition_variable timelineWake;
+static bool timelineStopping = false;
+static std::thread timelineThread;
+static std::vector<std::pair<long, long>> timeline; /* (ms since start, live bytes) */
+
+HeapProfile::TypeCounts::TypeCounts(const std::type_info &type, size_t objectSize)
+        : type(type), objectSize(objectSize), allocations(0), bytes(0), live(0), peakLive(0) {
+    std::lock_guard<std::mutex> guard(typesLock);
+    types.push_back(this);
+}
+
+void HeapProfile::allocated(TypeCounts &counts, size_t bytes) {
+    counts.allocations.fetch_add(1, std::memory_order_relaxed);
+    counts.bytes.fetch_add(static_cast<long>(bytes), std::memory_order_relaxed);
+    long live = counts.live.fetch_add(1, std::memory_order_relaxed) + 1;
+    long peak = counts.peakLive.load(std::memory_order_relaxed);
+    while (live > peak && !counts.peakLive.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+    liveBytes.fetch_add(static_cast<long>(bytes), std::memory_order_relaxed);
+}
+
+void HeapProfile::freed(TypeCounts &counts, size_t bytes) {
+    if (counts.live.fetch_sub(1, std::memory_order_relaxed) <= 0)
+        counts.live.fetch_add(1, std::memory_order_relaxed);
+    if (liveBytes.fetch_sub(static_cast<long>(bytes), std::memory_order_relaxed) < static_cast<long>(bytes))
+        liveBytes.fetch_add(static_cast<long>(bytes), std::memory_order_relaxed);
+}
+
+void HeapProfile::start(std::chrono::milliseconds interval) {
+    if (enabled)
+        throw std::runtime_error("heap profile already running");
+    {
+        std::lock_guard<std::mutex> guard(typesLock);
+        for (TypeCounts *counts : types) {
+            counts->allocations = 0;
+            counts->bytes = 0;
+            counts->live = 0;
+            counts->peakLive = 0;
+        }
+    }
+    /* frees are not counted while stopped, so older objects cannot be told apart */
+    liveBytes = 0;
+    {
+        std::lock_guard<std::mutex> guard(timelineLock);
+        timeline.clear();
+        timelineStopping = false;
+    }
+    enabled = true;
+
+    if (interval.count() < 1)
+        interval = std::chrono::milliseconds(1);
+    timelineThread = std::thread([interval] {
+        auto started = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> guard(timelineLock);
+        do {
+            long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - started).count();
+            timeline.emplace_back(elapsed, liveBytes.load());
+        } while (!timelineWake.wait_for(guard, interval, [] { return timelineStopping; }));
+    });
+}
+
+/**
+ * @return the readable name of `type`, such as `ExtendedEnv`.
+ */
+static std::string typeName(const std::type_info &type) {
+    int status = 0;
+    char *demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+    std::string name = status == 0 && demangled != nullptr ? demangled : type.name();
+    free(demangled);
+    return name;
+}
+
+std::string HeapProfile::stop() {
+    if (!enabled)
+        return "";
+    {
+        std::lock_guard<std::mutex> guard(timelineLock);
+        timelineStopping = true;
+    }
+    timelineWake.notify_all();
+    timelineThread.join();
+    enabled = false;
+
+    std::vector<TypeCounts *> allocatedTypes;
+    {
+        std::lock_guard<std::mutex> guard(typesLock);
+        for (TypeCounts *counts : types) {
+            if (counts->allocations > 0)
+                allocatedTypes.push_back(counts);
+        }
+    }
+    std::stable_sort(allocatedTypes.begin(), allocatedTypes.end(), [](TypeCounts *a, TypeCounts *b) {
+        return a->bytes > b->bytes;
+    });
+
+    std::ostringstream out;
+    out << "type allocations bytes object_bytes live peak_live\n";
+    for (TypeCounts *counts : allocatedTypes) {
+        out << typeName(counts->type) << " " << counts->allocations << " " << counts->bytes << " "
+            << counts->allocations * static_cast<long>(counts->objectSize) << " " << counts->live << " "
+            << counts->peakLive << "\n";
+    }
+    out << "timeline_ms live_bytes\n";
+    for (const std::pair<long, long> &sample : timeline)
+        out << sample.first << " " << sample.second << "\n";
+    return out.str();
+}
+
+/**
+ * @return the `type` row of `report` split into its numbers.
+ */
+static std::vector<long> row(const std::string &report, const std::string &type) {
+    std::istringstream in(report);
+    std::string line;
+    std::vector<long> numbers;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string name;
+        fields >> name;
+        if (name == type) {
+            long number;
+            while (fields >> number)
+                numbers.push_back(number);
+        }
+    }
+    return numbers;
+}
+
+TEST_CASE("heap profile") {
+    CHECK(HeapProfile::stop() == "");
+    HeapProfile::start(std::chrono::milliseconds(1));
+    CHECK_THROWS(HeapProfile::start());
+    CHECK(Program::run(Program::StepMode, "_let f = _fun (x) x + 1 _in f(1) + f(2) + f(3)", nullptr) == "9");
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    std::string report = HeapProfile::stop();
+
+    CHECK(report.find("type allocations bytes object_bytes live peak_live\n") == 0);
+    std::vector<long> callConts = row(report, "CallCont");
+    REQUIRE(callConts.size() == 5);
+    CHECK(callConts[0] == 3);
+    CHECK(callConts[1] > callConts[2]);
+    CHECK(callConts[3] == 0);
+    CHECK(callConts[4] >= 1);
+    std::vector<long> environments = row(report, "ExtendedEnv");
+    REQUIRE(environments.size() == 5);
+    CHECK(environments[0] == 4);
+    CHECK(report.find("\ntimeline_ms live_bytes\n0 ") != std::string::npos);
+
+    CHECK(Program::run(Program::InterpMode, "1 + 2", nullptr) == "3");
+    CHECK(HeapProfile::stop() == "");
+}
+
+TEST_CASE("heap profile counts live objects from its own start") {
+    HeapProfile::start();
+    PTR(Expression) older = parseSource("1 + 2");
+    HeapProfile::stop();
+    /* freed while stopped, so the profile never sees it go */
+    older = nullptr;
+
+    HeapProfile::start();
+    PTR(Expression) newer = parseSource("3 + 4");
+    std::string report = HeapProfile::stop();
+    std::vector<long> adds = row(report, "AddExpression");
+    REQUIRE(adds.size() == 5);
+    CHECK(adds[0] == 1);
+    CHECK(adds[3] == 1);
+    CHECK(adds[4] == 1);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <typeinfo>
+
+/**
+ * An allocation profiler for everything made with `NEW`: how many
+ * objects of each type were allocated, how many bytes that took with
+ * their `shared_ptr` control blocks and without, and how many were
+ * live now and at most at once. While it runs, a background thread
+ * also records the total live bytes every `interval`, as a timeline
+ * of the heap during the evaluation.
+ *
+ * `ChargedAllocator` reports to it, so while it is stopped an
+ * allocation costs one relaxed load more. Frees are not counted while
+ * it is stopped either, so every profile starts with nothing live:
+ * objects made before `start` are left out, and any freed while
+ * running are not counted below zero.
+ */
+class HeapProfile {
+public:
+    /**
+     * The counts for one type made with `NEW`.
+     */
+    class TypeCounts {
+    public:
+        const std::type_info &type;
+        size_t objectSize;
+        std::atomic<long> allocations;
+        std::atomic<long> bytes;
+        std::atomic<long> live;
+        std::atomic<long> peakLive;
+
+        TypeCounts(const std::type_info &type, size_t objectSize);
+    };
+
+    static std::atomic<bool> enabled;
+
+    template<class T>
+    static TypeCounts &countsFor() {
+        static TypeCounts counts(typeid(T), sizeof(T));
+        return counts;
+    }
+
+    static void allocated(TypeCounts &counts, size_t bytes);
+
+    static void freed(TypeCounts &counts, size_t bytes);
+
+    /**
+     * Starts counting, with allocation counts, live counts and peaks zeroed.
+     * @param interval time between timeline samples.
+     * @throws Throws `runtime_error` if a profile is already running.
+     */
+    static void start(std::chrono::milliseconds interval = std::chrono::milliseconds(10));
+
+    /**
+     * Stops counting.
+     * @return a table of the types allocated while running, most bytes
+     * first, then the timeline as `ms live_bytes` lines.
+     */
+    static std::string stop();
+};
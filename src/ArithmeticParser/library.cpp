@@ -0,0 +1,146 @@
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "library.h"
+#include "parse.h"
+#include "Environment.h"
+#include "expression.hpp"
+#include "step.h"
+#include "../catch/catch.hpp"
+
+ScriptError::ScriptError() {
+    this->kind = NoError;
+}
+
+bool ScriptError::failed() const {
+    return kind != NoError;
+}
+
+Bindings::Bindings() {
+    this->env = Environment::empty();
+}
+
+Bindings::Bindings(PTR(Environment) env) {
+    this->env = std::move(env);
+}
+
+Bindings Bindings::bind(const std::string &name, int value) const {
+    return bind(name, NEW(NumberValue)(value));
+}
+
+Bindings Bindings::bind(const std::string &name, bool value) const {
+    return bind(name, NEW(BooleanValue)(value));
+}
+
+Bindings Bindings::bind(const std::string &name, PTR(Value) value) const {
+    return Bindings(NEW(ExtendedEnv)(name, std::move(value), env));
+}
+
+PTR(Environment) Bindings::environment() const {
+    return env;
+}
+
+Script::Script(PTR(Expression) expression) {
+    this->expression = std::move(expression);
+}
+
+PTR(Script) Script::compile(const std::string &source, ScriptError &error) {
+    try {
+        std::istringstream in(source);
+        PTR(Script) script = NEW(Script)(parse(in));
+        error = ScriptError();
+        return script;
+    } catch (std::runtime_error &exn) {
+        error.kind = ScriptError::ParseError;
+        error.message = exn.what();
+        return nullptr;
+    }
+}
+
+PTR(Value) Script::evaluate(const Bindings &bindings, ScriptError &error) const {
+    try {
+        PTR(Value) result = expression->interpret(bindings.environment());
+        error = ScriptError();
+        return result;
+    } catch (std::runtime_error &exn) {
+        error.kind = ScriptError::EvaluationError;
+        error.message = exn.what();
+        return nullptr;
+    }
+}
+
+PTR(Value) Script::evaluateBySteps(const Bindings &bindings, ScriptError &error) const {
+    try {
+        PTR(Value) result = Step::interpBySteps(expression, bindings.environment());
+        error = ScriptError();
+        return result;
+    } catch (std::runtime_error &exn) {
+        error.kind = ScriptError::EvaluationError;
+        error.message = exn.what();
+        return nullptr;
+    }
+}
+
+PTR(Script) Script::optimize(ScriptError &error) const {
+    try {
+        PTR(Script) script = NEW(Script)(expression->optimize());
+        error = ScriptError();
+        return script;
+    } catch (std::runtime_error &exn) {
+        error.kind = ScriptError::EvaluationError;
+        error.message = exn.what();
+        return nullptr;
+    }
+}
+
+std::string Script::toString() const {
+    return expression->toString();
+}
+
+TEST_CASE("library compile and evaluate") {
+    ScriptError error;
+    CHECK(Script::compile("1 +", error) == nullptr);
+    CHECK(error.kind == ScriptError::ParseError);
+
+    PTR(Script) script = Script::compile("_if big _then x * x _else x + 1", error);
+    REQUIRE(script != nullptr);
+    CHECK(!error.failed());
+
+    Bindings x = Bindings().bind("x", 7);
+    CHECK(script->evaluate(x.bind("big", true), error)->toString() == "49");
+    CHECK(script->evaluateBySteps(x.bind("big", false), error)->toString() == "8");
+    CHECK(!error.failed());
+
+    CHECK(script->evaluate(x, error) == nullptr);
+    CHECK(error.kind == ScriptError::EvaluationError);
+    CHECK(error.message == "free variable: big");
+
+    PTR(Script) twice = Script::compile("_fun (y) f(f(y))", error);
+    PTR(Value) addOne = Script::compile("_fun (n) n + 1", error)->evaluate(Bindings(), error);
+    PTR(Value) addTwo = twice->evaluate(Bindings().bind("f", addOne), error);
+    CHECK(addTwo->call(NEW(NumberValue)(40))->toString() == "42");
+
+    CHECK(Script::compile("y + 1 + 2", error)->optimize(error)->toString() == "(y + 3)");
+}
+
+TEST_CASE("library scripts shared between threads") {
+    ScriptError error;
+    PTR(Script) script = Script::compile("_let count = _fun(count) _fun(n)\n"
+                                         "_if n == 0 _then 0 _else 1 + count(count)(n + -1)\n"
+                                         "_in count(count)(start)", error);
+    std::vector<std::string> results(8);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; i++) {
+        threads.emplace_back([&script, &results, i] {
+            ScriptError threadError;
+            Bindings start = Bindings().bind("start", 1000 * i);
+            results[i] = (i % 2 == 0 ? script->evaluate(start, threadError)
+                                     : script->evaluateBySteps(start, threadError))->toString();
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+    for (int i = 0; i < 8; i++)
+        CHECK(results[i] == std::to_string(1000 * i));
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <string>
+#include "pointer.h"
+#include "value.h"
+
+class Expression;
+
+class Environment;
+
+/**
+ * The embedding API: compile MSDScript source once into a `Script`,
+ * then evaluate it as often as needed, optionally with host values
+ * bound to its free variables. Failures are reported through a
+ * `ScriptError` instead of exceptions.
+ *
+ * A `Script` and a `Bindings` never change after they are built, and
+ * evaluation only touches per-thread state, so one compiled script
+ * can be evaluated from many threads at once.
+ *
+ * The library is the `ArithmeticParser` target of ArithmeticParser.cbp:
+ * every source here but main.cpp, built with -DCATCH_CONFIG_DISABLE so
+ * their Catch `TEST_CASE`s are left out.
+ */
+
+/**
+ * Why a compile or evaluate call failed, if it did.
+ */
+class ScriptError {
+public:
+    typedef enum {
+        NoError,
+        ParseError,
+        EvaluationError
+    } kindT;
+
+    kindT kind;
+    std::string message;
+
+    ScriptError();
+
+    bool failed() const;
+};
+
+/**
+ * Host values for a script's free variables. `bind` returns a new
+ * `Bindings`, so a set of bindings can be shared and extended freely.
+ */
+class Bindings {
+public:
+    Bindings();
+
+    Bindings bind(const std::string &name, int value) const;
+
+    Bindings bind(const std::string &name, bool value) const;
+
+    /**
+     * Binds any value, such as a function produced by another script.
+     */
+    Bindings bind(const std::string &name, PTR(Value) value) const;
+
+    PTR(Environment) environment() const;
+
+private:
+    PTR(Environment) env;
+
+    explicit Bindings(PTR(Environment) env);
+};
+
+class Script {
+public:
+    /**
+     * @param source the text of one MSDScript program.
+     * @param error set to describe the parse error, if any.
+     * @return the compiled script, or null if `source` does not parse.
+     */
+    static PTR(Script) compile(const std::string &source, ScriptError &error);
+
+    /**
+     * Interprets the script with `bindings` for its free variables.
+     * @return the result, or null with `error` set if evaluation fails.
+     */
+    PTR(Value) evaluate(const Bindings &bindings, ScriptError &error) const;
+
+    /**
+     * Like `evaluate`, but interprets by steps, so deep recursion does
+     * not use the native stack.
+     */
+    PTR(Value) evaluateBySteps(const Bindings &bindings, ScriptError &error) const;
+
+    /**
+     * @return the optimized script, or null with `error` set if
+     * optimizing fails.
+     */
+    PTR(Script) optimize(ScriptError &error) const;
+
+    std::string toString() const;
+
+    explicit Script(PTR(Expression) expression);
+
+private:
+    PTR(Expression) expression;
+};
@@ -1,40 +1,244 @@
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include "parse.h"
 #include "Environment.h"
 #include "step.h"
+#include "program.h"
+#include "pool.h"
+#include "server.h"
+#include "cache.h"
+#include "parallel.h"
+#include "stats.h"
+#include "profile.h"
+#include "trace.h"
+#include "heap.h"
+#include "perf.h"
 
-#define CATCH_CONFIG_RUNNER
+static void printStats() {
+    std::cerr << Stats::report();
+}
+
+static const char *profileFile = nullptr;
+static const char *traceFile = nullptr;
+static const char *heapProfileFile = nullptr;
+
+static void writeProfile() {
+    std::ofstream out(profileFile);
+    out << Profiler::stop();
+    if (!out)
+        std::cerr << "cannot write " << profileFile << std::endl;
+}
+
+static void writeTrace() {
+    std::ofstream out(traceFile);
+    out << Tracer::stop();
+    if (!out)
+        std::cerr << "cannot write " << traceFile << std::endl;
+}
+
+static void writeHeapProfile() {
+    std::ofstream out(heapProfileFile);
+    out << HeapProfile::stop();
+    if (!out)
+        std::cerr << "cannot write " << heapProfileFile << std::endl;
+}
 
+/**
+ * main [-interp | -step | -opt | -auto] [-stream [delimiter]] [-cache size]
+ * main [-interp | -step | -opt | -auto] -batch file [delimiter] [-j jobs] [-cache size] [-max-cost cost]
+ * main -server socket [-j jobs] [-cache size]
+ * main -parallel [-j jobs]
+ *
+ * All but `-parallel` may add `-fuel steps`, `-timeout ms` and
+ * `-memory bytes`, which stop each program after that many evaluation
+ * steps or milliseconds, or once it has that many heap bytes live.
+ * Any may add `-stats`, which prints the `Stats` counts to standard
+ * error on exit; they are only counted in builds with `-DMSD_STATS`.
+ * Any may also add `-profile file`, which samples the running MSDScript
+ * functions and writes them to `file` on exit as folded stacks for a
+ * flame graph; see `Profiler`. `-trace file` writes the parses,
+ * optimizations and evaluations to `file` on exit as Chrome trace-event
+ * JSON; `-trace-calls n` adds one function call in `n` on each thread
+ * and `-trace-min us` leaves out anything shorter. See `Tracer`.
+ * `-heap-profile file` writes the objects allocated by type and a
+ * timeline of live heap bytes to `file` on exit; see `HeapProfile`.
+ * `-perf`, when reading one program, prints the time, hardware
+ * counters and IPC of parsing and of evaluating (or optimizing) it to
+ * standard error; see `PerfCounters`.
+ *
+ * Without `-stream` or `-batch`, reads one program from standard input
+ * and prints its result. With `-stream`, reads programs separated by
+ * `delimiter` (a newline by default) until end of file and prints one
+ * result per program, reporting failed programs on standard error.
+ * `-batch` does the same for the programs in `file`, evaluating them
+ * on `jobs` threads (all cores by default) but printing in file order;
+ * it starts the programs with the highest `CostEstimate` first and
+ * refuses any estimated to cost more than `cost`. `-auto` picks the
+ * interpreter or step mode for each program from its estimate.
+ * `-server` answers requests on the Unix domain socket `socket` until
+ * killed; see `Server` for the protocol. `-cache` keeps the parsed and
+ * optimized forms of up to `size` distinct programs (the server always
+ * caches, 4096 programs by default). `-parallel` interprets one
+ * program with its independent operands evaluated on `jobs` threads.
+ */
 int main(int argc, char **argv) {
-    if (argc == 1) {
+    Program::modeT mode = Program::InterpMode;
+    bool streaming = false;
+    bool parallel = false;
+    bool perf = false;
+    const char *batchFile = nullptr;
+    const char *socketPath = nullptr;
+    int jobs = 0; /* all cores unless -j, found only when needed */
+    long cacheSize = 0;
+    char delimiter = '\n';
+    long fuel = -1;
+    long timeoutMillis = 0;
+    long memory = -1;
+    double maxCost = -1;
+    long traceCalls = 0;
+    long traceMinMicros = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (Program::modeFromFlag(argv[i], mode)) {
+            continue;
+        } else if (strcmp(argv[i], "-stream") == 0) {
+            streaming = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-' && argv[i + 1][0] != '\0')
+                delimiter = argv[++i][0];
+        } else if (strcmp(argv[i], "-parallel") == 0) {
+            parallel = true;
+        } else if (strcmp(argv[i], "-perf") == 0) {
+            perf = true;
+        } else if (strcmp(argv[i], "-stats") == 0) {
+            atexit(printStats);
+        } else if (strcmp(argv[i], "-profile") == 0 && i + 1 < argc) {
+            profileFile = argv[++i];
+        } else if (strcmp(argv[i], "-trace") == 0 && i + 1 < argc) {
+            traceFile = argv[++i];
+        } else if (strcmp(argv[i], "-heap-profile") == 0 && i + 1 < argc) {
+            heapProfileFile = argv[++i];
+        } else if (strcmp(argv[i], "-trace-calls") == 0 && i + 1 < argc && atol(argv[i + 1]) > 0) {
+            traceCalls = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-trace-min") == 0 && i + 1 < argc && atol(argv[i + 1]) >= 0) {
+            traceMinMicros = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-batch") == 0 && i + 1 < argc) {
+            batchFile = argv[++i];
+            if (i + 1 < argc && argv[i + 1][0] != '-' && argv[i + 1][0] != '\0')
+                delimiter = argv[++i][0];
+        } else if (strcmp(argv[i], "-server") == 0 && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (strcmp(argv[i], "-cache") == 0 && i + 1 < argc && atol(argv[i + 1]) > 0) {
+            cacheSize = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-fuel") == 0 && i + 1 < argc && atol(argv[i + 1]) >= 0) {
+            fuel = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-timeout") == 0 && i + 1 < argc && atol(argv[i + 1]) > 0) {
+            timeoutMillis = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-memory") == 0 && i + 1 < argc && atol(argv[i + 1]) > 0) {
+            memory = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-max-cost") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0) {
+            maxCost = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            jobs = atoi(argv[++i]);
+        } else {
+            std::cout << "bad flag " << std::endl;
+            return 1;
+        }
+    }
+
+    Program::setLimits(fuel, std::chrono::milliseconds(timeoutMillis), memory);
+    if (jobs == 0 && (socketPath != nullptr || batchFile != nullptr || parallel))
+        jobs = WorkStealingPool::defaultWorkerCount();
+
+    /* nothing here mixes C stdio with the streams */
+    std::ios::sync_with_stdio(false);
+    std::cin.tie(nullptr);
+
+    if (profileFile != nullptr) {
+        Profiler::start();
+        atexit(writeProfile);
+    }
+    if (traceFile != nullptr) {
+        Tracer::start(traceCalls, std::chrono::microseconds(traceMinMicros));
+        atexit(writeTrace);
+    }
+    if (heapProfileFile != nullptr) {
+        HeapProfile::start();
+        atexit(writeHeapProfile);
+    }
+
+    if (socketPath != nullptr) {
         try {
-            PTR(Expression) e = parse(std::cin);
-            std::cout << e->interpret(NEW(EmptyEnv)())->toString() << std::endl;
-        } catch (int e) {
-            std::cerr << e << std::endl;
-            return e;
+            Server server(socketPath, jobs, cacheSize > 0 ? cacheSize : 4096);
+            server.run();
+        } catch (std::runtime_error &exn) {
+            std::cerr << exn.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (batchFile != nullptr) {
+        std::ifstream in(batchFile);
+        if (!in) {
+            std::cerr << "cannot open " << batchFile << std::endl;
+            return 1;
         }
-    } else if (strncmp(argv[1], "-opt", 3) == 0) {
+        ProgramCache cache(cacheSize);
+        int failures = Program::batch(mode, in, std::cout, std::cerr, delimiter, jobs,
+                                      cacheSize > 0 ? &cache : nullptr, maxCost);
+        std::cout.flush();
+        return failures == 0 ? 0 : 1;
+    }
+
+    if (streaming) {
+        ProgramCache cache(cacheSize);
+        int failures = Program::stream(mode, std::cin, std::cout, std::cerr, delimiter,
+                                       cacheSize > 0 ? &cache : nullptr);
+        std::cout.flush();
+        return failures == 0 ? 0 : 1;
+    }
+
+    if (parallel) {
         try {
-            PTR(Expression) e = parse(std::cin);
-            std::cout << e->optimize()->toString() << std::endl;
-        } catch (int e) {
-            std::cerr << e << std::endl;
-            return e;
+            ParallelInterpreter interpreter(jobs);
+            std::cout << interpreter.interpret(parse(std::cin), Environment::empty())->toString() << std::endl;
+        } catch (std::runtime_error &exn) {
+            std::cerr << exn.what() << std::endl;
+            return 1;
         }
-    } else if (strncmp(argv[1], "-step", 4) == 0) {
+        return 0;
+    }
+
+    if (perf) {
+        PerfCounters counters;
+        std::string result;
         try {
-            PTR(Expression) e = parse(std::cin);
-            std::cout << Step::interpBySteps(e)->toString() << std::endl;
-        } catch (int e) {
-            std::cerr << e << std::endl;
-            return e;
+            PTR(Expression) e;
+            {
+                PerfCounters::Phase phase(counters, "parse");
+                e = parse(std::cin);
+            }
+            PerfCounters::Phase phase(counters, mode == Program::OptimizeMode ? "optimize" : "evaluate");
+            result = Program::evaluate(mode, e);
+        } catch (std::runtime_error &exn) {
+            std::cerr << exn.what() << std::endl;
+            return 1;
         }
-    } else {
-        std::cout << "bad flag " << std::endl;
+        std::cout << result << std::endl;
+        std::cerr << counters.report();
+        return 0;
+    }
+
+    try {
+        std::cout << Program::run(mode, std::cin) << '\n';
+    } catch (int e) {
+        std::cerr << e << std::endl;
+        return e;
+    } catch (std::runtime_error &exn) {
+        /* a parse error, an evaluation error, or running out of -fuel, -timeout or -memory */
+        std::cerr << exn.what() << std::endl;
         return 1;
     }
     return 0;
 }
-
-
@@ -0,0 +1,228 @@
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "parallel.h"
+#include "budget.h"
+#include "Environment.h"
+#include "expression.hpp"
+#include "value.h"
+#include "parse.h"
+#include "../catch/catch.hpp"
+
+ParallelInterpreter::ParallelInterpreter(int workers, int maxForkDepth) : pool(workers) {
+    this->maxForkDepth = maxForkDepth;
+}
+
+PTR(Value) ParallelInterpreter::interpret(PTR(Expression) e, PTR(Environment) env) {
+    CallSet calls = nodesContainingCalls(e);
+    return evaluate(e, env, 0, calls, nullptr);
+}
+
+ParallelInterpreter::Fork::Fork(const Fork *parent) : cancelled(false), claimed(false), done(false) {
+    this->parent = parent;
+}
+
+bool ParallelInterpreter::Fork::isCancelled() const {
+    for (const Fork *fork = this; fork != nullptr; fork = fork->parent)
+        if (fork->cancelled.load(std::memory_order_relaxed))
+            return true;
+    return false;
+}
+
+/**
+ * Mirrors each expression's `interpret`, except that operand pairs go
+ * through `evaluatePair` and function bodies are evaluated here too,
+ * so calls inside them can fork as well. Once no fork is possible
+ * below `e`, it is handed to the plain interpreter.
+ */
+PTR(Value) ParallelInterpreter::evaluate(const PTR(Expression) &e, const PTR(Environment) &env, int depth,
+                                         const CallSet &calls, const Fork *fork) {
+    if (fork != nullptr && fork->isCancelled())
+        throw EvaluationAborted(EvaluationAborted::Cancelled);
+    if (depth >= maxForkDepth || calls.count(e.get()) == 0)
+        return e->interpret(env);
+
+    PTR(Value) left;
+    PTR(Value) right;
+
+    if (PTR(AddExpression) add = CAST(AddExpression)(e)) {
+        evaluatePair(add->leftExpression, add->rightExpression, env, depth, calls, fork, left, right);
+        return left->addedTo(right);
+    }
+    if (PTR(MultiplyExpression) multiply = CAST(MultiplyExpression)(e)) {
+        evaluatePair(multiply->leftExpression, multiply->rightExpression, env, depth, calls, fork, left, right);
+        return left->multipliedBy(right);
+    }
+    if (PTR(EqualsExpression) equals = CAST(EqualsExpression)(e)) {
+        evaluatePair(equals->leftExpression, equals->rightExpression, env, depth, calls, fork, left, right);
+        return NEW(BooleanValue)(left->equals(right));
+    }
+    if (PTR(CallExpression) call = CAST(CallExpression)(e)) {
+        evaluatePair(call->toBeCalled, call->actualArg, env, depth, calls, fork, left, right);
+        PTR(FunctionValue) function = CAST(FunctionValue)(left);
+        if (function == nullptr)
+            return left->call(right);
+        return evaluate(function->body, NEW(ExtendedEnv)(function->formalArg, right, function->env), depth, calls,
+                        fork);
+    }
+    if (PTR(LetExpression) let = CAST(LetExpression)(e)) {
+        PTR(Value) rhsVal = evaluate(let->rhs, env, depth, calls, fork);
+        return evaluate(let->body, NEW(ExtendedEnv)(let->var, rhsVal, env), depth, calls, fork);
+    }
+    if (PTR(IfExpression) ifExpression = CAST(IfExpression)(e)) {
+        return evaluate(ifExpression->testPart, env, depth, calls, fork)->isTrue()
+               ? evaluate(ifExpression->thenResult, env, depth, calls, fork)
+               : evaluate(ifExpression->elseResult, env, depth, calls, fork);
+    }
+    return e->interpret(env);
+}
+
+/**
+ * Evaluates `left` on this thread while `right` is queued on the
+ * pool, or both on this thread if the pair is not worth forking.
+ * Whichever thread claims the queued `right` first evaluates it; the
+ * queue may still hold the task after this frame returns, so the task
+ * only touches this frame once it has made the claim, and this frame
+ * always waits for a claimed `right`, cancelling it if `left` fails.
+ *
+ * `right` runs under a `Budget` watching its fork, so the plain
+ * interpreter stops too once the fork is cancelled. A cancelled
+ * enclosing fork stops `left`, or is passed on while waiting.
+ */
+void ParallelInterpreter::evaluatePair(const PTR(Expression) &left, const PTR(Expression) &right,
+                                       const PTR(Environment) &env, int depth, const CallSet &calls,
+                                       const Fork *fork, PTR(Value) &leftValue, PTR(Value) &rightValue) {
+    if (depth >= maxForkDepth || calls.count(left.get()) == 0 || calls.count(right.get()) == 0) {
+        leftValue = evaluate(left, env, depth, calls, fork);
+        rightValue = evaluate(right, env, depth, calls, fork);
+        return;
+    }
+
+    std::shared_ptr<Fork> rightFork = std::make_shared<Fork>(fork);
+    auto runRight = [this, &right, &env, depth, &calls](Fork &forked) {
+        if (forked.claimed.exchange(true))
+            return;
+        Budget budget(-1, std::chrono::milliseconds(0), &forked.cancelled);
+        try {
+            Budget::Scope scope(&budget);
+            forked.value = evaluate(right, env, depth + 1, calls, &forked);
+        } catch (...) {
+            forked.error = std::current_exception();
+        }
+        forked.done.store(true, std::memory_order_release);
+    };
+    pool.submit([runRight, rightFork] { runRight(*rightFork); });
+
+    std::exception_ptr leftError;
+    try {
+        leftValue = evaluate(left, env, depth + 1, calls, fork);
+    } catch (...) {
+        leftError = std::current_exception();
+        rightFork->cancelled.store(true, std::memory_order_relaxed);
+    }
+
+    runRight(*rightFork);
+    while (!rightFork->done.load(std::memory_order_acquire)) {
+        if (fork != nullptr && fork->isCancelled())
+            rightFork->cancelled.store(true, std::memory_order_relaxed);
+        std::this_thread::yield();
+    }
+    if (leftError)
+        std::rethrow_exception(leftError);
+    if (rightFork->error)
+        std::rethrow_exception(rightFork->error);
+    rightValue = rightFork->value;
+}
+
+/**
+ * @return every node of `e` that has a call expression in its
+ * subtree, found without recursion so deep programs are fine.
+ */
+ParallelInterpreter::CallSet ParallelInterpreter::nodesContainingCalls(const PTR(Expression) &e) {
+    CallSet calls;
+    std::vector<std::pair<PTR(Expression), bool>> pending;
+    std::vector<PTR(Expression)> children;
+    pending.emplace_back(e, false);
+
+    while (!pending.empty()) {
+        PTR(Expression) node = pending.back().first;
+        bool childrenDone = pending.back().second;
+        pending.pop_back();
+
+        children.clear();
+        if (PTR(AddExpression) add = CAST(AddExpression)(node)) {
+            children = {add->leftExpression, add->rightExpression};
+        } else if (PTR(MultiplyExpression) multiply = CAST(MultiplyExpression)(node)) {
+            children = {multiply->leftExpression, multiply->rightExpression};
+        } else if (PTR(EqualsExpression) equals = CAST(EqualsExpression)(node)) {
+            children = {equals->leftExpression, equals->rightExpression};
+        } else if (PTR(CallExpression) call = CAST(CallExpression)(node)) {
+            children = {call->toBeCalled, call->actualArg};
+        } else if (PTR(LetExpression) let = CAST(LetExpression)(node)) {
+            children = {let->rhs, let->body};
+        } else if (PTR(IfExpression) ifExpression = CAST(IfExpression)(node)) {
+            children = {ifExpression->testPart, ifExpression->thenResult, ifExpression->elseResult};
+        } else if (PTR(FunctionExpression) function = CAST(FunctionExpression)(node)) {
+            children = {function->body};
+        }
+
+        if (!childrenDone) {
+            pending.emplace_back(node, true);
+            for (PTR(Expression) &child : children)
+                pending.emplace_back(child, false);
+            continue;
+        }
+        bool hasCall = CAST(CallExpression)(node) != nullptr;
+        for (PTR(Expression) &child : children)
+            hasCall = hasCall || calls.count(child.get()) > 0;
+        if (hasCall)
+            calls.insert(node.get());
+    }
+    return calls;
+}
+
+TEST_CASE("parallel interpreter") {
+    ParallelInterpreter parallel(4, 6);
+    std::string fib = "_let fib = _fun (fib) _fun (n)\n"
+                      "_if n == 0 _then 0 _else _if n == 1 _then 1\n"
+                      "_else fib(fib)(n + -1) + fib(fib)(n + -2)\n"
+                      "_in ";
+    PTR(Expression) e = parseSource(fib + "fib(fib)(18)");
+    CHECK(parallel.interpret(e, Environment::empty())->toString() == "2584");
+    CHECK(parallel.interpret(e, Environment::empty())->equals(e->interpret(Environment::empty())));
+    CHECK(parallel.interpret(parseSource("1 + 2 * 3"), Environment::empty())->toString() == "7");
+    CHECK(parallel.interpret(parseSource("(_fun (x) x * x)(5) == 25"), Environment::empty())->toString() == "_true");
+
+    /* both sides fail; the left error wins, as in interpret */
+    PTR(Expression) bad = parseSource(fib + "(fib(fib)(10) + _true) + y(fib(fib)(10))");
+    CHECK_THROWS_WITH(bad->interpret(Environment::empty()), "not a number");
+    CHECK_THROWS_WITH(parallel.interpret(bad, Environment::empty()), "not a number");
+    CHECK_THROWS_WITH(parallel.interpret(parseSource(fib + "fib(fib)(5) + y(1)"), Environment::empty()),
+                      "free variable: y");
+}
+
+TEST_CASE("parallel interpreter cancels the right operand when the left fails") {
+    ParallelInterpreter parallel(4, 6);
+    /* `interpret` never starts the endless right operand */
+    PTR(Expression) endless = parseSource("_let loop = _fun (f) f(f)"
+                                          " _in (_fun (x) x + _true)(1) + loop(loop)");
+    CHECK_THROWS_WITH(endless->interpret(Environment::empty()), "not a number");
+    CHECK_THROWS_WITH(parallel.interpret(endless, Environment::empty()), "not a number");
+
+    /* the endless operand is nested in forks inside the cancelled one */
+    PTR(Expression) nested = parseSource("_let loop = _fun (f) f(f)"
+                                         " _in _let count = _fun (f) _fun (n) _if n == 0 _then 0"
+                                         " _else 1 + f(f)(n + -1)"
+                                         " _in (count(count)(50) + y(1)) * (count(count)(10) + loop(loop))");
+    CHECK_THROWS_WITH(parallel.interpret(nested, Environment::empty()), "free variable: y");
+
+    /* a right operand that fails while the left one is fine still reports its error */
+    PTR(Expression) rightFails = parseSource("_let f = _fun (x) x _in f(1) + f(_true) * f(2)");
+    CHECK_THROWS_WITH(rightFails->interpret(Environment::empty()), "no multiplying booleans");
+    CHECK_THROWS_WITH(parallel.interpret(rightFails, Environment::empty()), "no multiplying booleans");
+}
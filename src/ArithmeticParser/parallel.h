@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <unordered_set>
+#include "pointer.h"
+#include "pool.h"
+
+class Expression;
+
+class Environment;
+
+class Value;
+
+/**
+ * An opt-in interpreter that evaluates the two operands of `+`, `*`,
+ * `==` and calls in parallel (fork-join) on a `WorkStealingPool`.
+ * It gives the same results and the same errors as `interpret`: when
+ * both operands fail, the left operand's error is reported.
+ *
+ * Forking costs far more than evaluating a small operand, so an
+ * operand pair is only forked when both operands contain a call (the
+ * only way an MSDScript expression can do unbounded work) and fewer
+ * than `maxForkDepth` forks enclose it; everything else runs
+ * sequentially on the current thread.
+ *
+ * When the left operand of a fork fails, the right one is cancelled,
+ * since `interpret` would never have started it: a right operand that
+ * never ends or nests too deep cannot hide the left operand's error.
+ * For the same reason a thread done with a left operand runs only its
+ * own right operand, if no worker has taken it yet, and otherwise
+ * waits for it; it never picks up other queued operands.
+ */
+class ParallelInterpreter {
+public:
+    /**
+     * @param workers threads in the pool.
+     * @param maxForkDepth how many forks may be nested, so at most
+     * 2^maxForkDepth operands are in flight for one evaluation.
+     */
+    explicit ParallelInterpreter(int workers, int maxForkDepth = 8);
+
+    /**
+     * @throws Throws `runtime_error` for evaluation errors.
+     */
+    PTR(Value) interpret(PTR(Expression) e, PTR(Environment) env);
+
+private:
+    typedef std::unordered_set<const Expression *> CallSet;
+
+    /**
+     * The right operand of one fork. Setting `cancelled` stops its
+     * evaluation and that of every fork made while evaluating it.
+     */
+    class Fork {
+    public:
+        std::atomic<bool> cancelled;
+        std::atomic<bool> claimed; /* a thread has started evaluating it */
+        std::atomic<bool> done;
+        const Fork *parent;        /* the fork whose right operand made this one, if any */
+        PTR(Value) value;
+        std::exception_ptr error;
+
+        explicit Fork(const Fork *parent);
+
+        bool isCancelled() const;
+    };
+
+    WorkStealingPool pool;
+    int maxForkDepth;
+
+    PTR(Value) evaluate(const PTR(Expression) &e, const PTR(Environment) &env, int depth, const CallSet &calls,
+                        const Fork *fork);
+
+    void evaluatePair(const PTR(Expression) &left, const PTR(Expression) &right, const PTR(Environment) &env,
+                      int depth, const CallSet &calls, const Fork *fork, PTR(Value) &leftValue,
+                      PTR(Value) &rightValue);
+
+    static CallSet nodesContainingCalls(const PTR(Expression) &e);
+};
@@ -1,15 +1,65 @@
 #include <iostream>
 #include <sstream>
+#include <vector>
 #include "parse.h"
 #include "Environment.h"
+#include "trace.h"
 #include "../catch/catch.hpp"
 
+/**
+ * One pending construct of the explicit parse stack. Every frame
+ * collects the operands and operators of a single expression (an
+ * `expr` in the grammar) and remembers, through `kind`, what the
+ * parser has to do with that expression once it is complete.
+ */
+class ParseFrame {
+public:
+    typedef enum {
+        TopFrame,     /* the whole input */
+        ParenFrame,   /* `(` expr `)` */
+        CallArgFrame, /* first `(` expr `)` */
+        LetRhsFrame,  /* _let var = expr _in ... */
+        LetBodyFrame, /* _let var = first _in expr */
+        IfTestFrame,  /* _if expr _then ... */
+        IfThenFrame,  /* _if first _then expr _else ... */
+        IfElseFrame,  /* _if first _then second _else expr */
+        FunBodyFrame  /* _fun (var) expr */
+    } kindT;
+
+    kindT kind;
+    std::string var;
+    PTR(Expression) first;
+    PTR(Expression) second;
+
+    std::vector<PTR(Expression)> operands;
+    std::vector<char> operators;
+
+    explicit ParseFrame(kindT kind, std::string var = "",
+                        PTR(Expression) first = nullptr, PTR(Expression) second = nullptr);
+};
+
+ParseFrame::ParseFrame(kindT kind, std::string var, PTR(Expression) first, PTR(Expression) second) {
+    this->kind = kind;
+    this->var = std::move(var);
+    this->first = std::move(first);
+    this->second = std::move(second);
+}
+
+static int precedence(char op);
+
+static void reduceTop(ParseFrame &frame);
+
+static PTR(Expression) parseParameter(std::istream &in);
+
+static void expectKeyword(std::istream &in, const std::string &keyword);
+
 /**
  * @param in input stream that contains an Expression.
  * @return the parsed representation of that Expression
  * @throws Throws `runtime_error` for parse errors.
  */
 PTR(Expression) parse(std::istream &in) {
+    Tracer::Span span("parse");
     PTR(Expression) e = parseExpr(in);
 
     char c = peekAfterSpaces(in);
@@ -22,189 +72,193 @@ PTR(Expression) parse(std::istream &in) {
 /**
  * Takes an input stream that starts with an Expression,
  * consuming the largest initial Expression possible.
- * @param in
- * @return
+ *
+ * This is a precedence-climbing parser that keeps its state in an
+ * explicit stack of `ParseFrame`s instead of the C++ call stack, so
+ * neither long operator chains nor deeply nested parentheses, calls,
+ * `_let`s, `_if`s and `_fun`s can exhaust the native stack. Every
+ * character is looked at a constant number of times, so parsing is
+ * linear in the size of the input. `+` and `==` share the lowest
+ * precedence, `*` binds tighter, and all three are right-associative.
+ * @param in input stream to be parsed.
+ * @return Expression parsed from input stream.
  */
 static PTR(Expression) parseExpr(std::istream &in) {
-    PTR(Expression) e = parseAddend(in);
+    std::vector<ParseFrame> stack;
+    stack.emplace_back(ParseFrame::TopFrame);
 
-    char c = peekAfterSpaces(in);
-    if (c == '+') {
-        in >> c;
-        PTR(Expression) rhs = parseExpr(in);
-        e = NEW(AddExpression)(e, rhs);
-    } else if (c == '=') {
-        in.get();
-        in >> c;
-        PTR(Expression) rhs = parseExpr(in);
-        e = NEW(EqualsExpression)(e, rhs);
-    }
+    while (true) {
+        /* parse one multicand, pushing a frame for every nested expression */
+        PTR(Expression) operand = nullptr;
+        while (operand == nullptr) {
+            char c = peekAfterSpaces(in);
+            if (c == '(') {
+                in.get();
+                stack.emplace_back(ParseFrame::ParenFrame);
+            } else if (c == '_') {
+                in.get();
+                std::string word = parseNextWord(in);
+                if (word == "let") {
+                    peekAfterSpaces(in);
+                    PTR(Expression) var = parseVariable(in);
+                    peekAfterSpaces(in);
+                    if (in.get() != '=')
+                        throw std::runtime_error("unknown Expression after variable in _let ");
+                    stack.emplace_back(ParseFrame::LetRhsFrame, var->toString());
+                } else if (word == "if") {
+                    stack.emplace_back(ParseFrame::IfTestFrame);
+                } else if (word == "fun") {
+                    PTR(Expression) parameter = parseParameter(in);
+                    stack.emplace_back(ParseFrame::FunBodyFrame, parameter->toString());
+                } else if (word == "true") {
+                    operand = NEW(BooleanExpression)(true);
+                } else if (word == "false") {
+                    operand = NEW(BooleanExpression)(false);
+                } else {
+                    throw std::runtime_error("unknown Expression beginning with '_'");
+                }
+            } else if (isdigit(c) || c == '-') {
+                operand = parseNumber(in);
+            } else if (isalpha(c)) {
+                operand = parseVariable(in);
+            } else {
+                throw std::runtime_error((std::string) "expected a digit or open parenthesis at " + c);
+            }
+        }
 
-    return e;
+        /* extend the multicand with calls, or finish the enclosing expressions */
+        while (true) {
+            char c = peekAfterSpaces(in);
+            if (c == '(') {
+                in.get();
+                stack.emplace_back(ParseFrame::CallArgFrame, "", operand);
+                break;
+            }
+
+            ParseFrame &frame = stack.back();
+            if (c == '+' || c == '*' || c == '=') {
+                in.get();
+                if (c == '=' && in.get() != '=')
+                    throw std::runtime_error("expected == ");
+                while (!frame.operators.empty() && precedence(frame.operators.back()) > precedence(c)) {
+                    frame.operands.push_back(operand);
+                    reduceTop(frame);
+                    operand = frame.operands.back();
+                    frame.operands.pop_back();
+                }
+                frame.operands.push_back(operand);
+                frame.operators.push_back(c);
+                break;
+            }
+
+            frame.operands.push_back(operand);
+            while (!frame.operators.empty())
+                reduceTop(frame);
+            PTR(Expression) e = frame.operands.back();
+            ParseFrame done = std::move(frame);
+            stack.pop_back();
+            operand = nullptr;
+
+            switch (done.kind) {
+                case ParseFrame::TopFrame:
+                    return e;
+                case ParseFrame::ParenFrame:
+                    if (peekAfterSpaces(in) != ')')
+                        throw std::runtime_error("expected a close parenthesis");
+                    in.get();
+                    operand = e;
+                    break;
+                case ParseFrame::CallArgFrame:
+                    peekAfterSpaces(in);
+                    in.get();
+                    operand = NEW(CallExpression)(done.first, e);
+                    break;
+                case ParseFrame::LetRhsFrame:
+                    expectKeyword(in, "in");
+                    stack.emplace_back(ParseFrame::LetBodyFrame, done.var, e);
+                    break;
+                case ParseFrame::LetBodyFrame:
+                    operand = NEW(LetExpression)(done.var, done.first, e);
+                    break;
+                case ParseFrame::IfTestFrame:
+                    expectKeyword(in, "then");
+                    stack.emplace_back(ParseFrame::IfThenFrame, "", e);
+                    break;
+                case ParseFrame::IfThenFrame:
+                    expectKeyword(in, "else");
+                    stack.emplace_back(ParseFrame::IfElseFrame, "", done.first, e);
+                    break;
+                case ParseFrame::IfElseFrame:
+                    operand = NEW(IfExpression)(done.first, done.second, e);
+                    break;
+                case ParseFrame::FunBodyFrame:
+                    operand = NEW(FunctionExpression)(done.var, e);
+                    break;
+            }
+            if (operand == nullptr)
+                break; /* a new frame was pushed, so start its first multicand */
+        }
+    }
 }
 
 /**
- * Takes an input stream that starts with an addend,
- * consuming the largest initial addend possible, where
- * an addend is an Expression that does not have `+`
- * except within nested expressions (like parentheses).
- * @param in input stream to be parsed.
- * @return Expression parsed from input stream.
+ * @param op one of `+`, `=` (for `==`) or `*`.
+ * @return how tightly `op` binds; higher binds tighter.
  */
-static PTR(Expression) parseAddend(std::istream &in) {
-    PTR(Expression) e = parseMulticand(in);
-
-    char c = peekAfterSpaces(in);
-    if (c == '*') {
-        in.get();
-        PTR(Expression) rhs = parseAddend(in);
-        e = NEW(MultiplyExpression)(e, rhs);
-    }
-
-    return e;
-}
-
-PTR(Expression) parseMulticand(std::istream &in) {
-    PTR(Expression) expr = parseInner(in);
-    while (peekAfterSpaces(in) == '(') {
-        in.get();
-        peekAfterSpaces(in);
-        PTR(Expression) actualArg = parseExpr(in);
-        peekAfterSpaces(in);
-        expr = NEW(CallExpression)(expr, actualArg);
-        in.get();
-    }
-    return expr;
+static int precedence(char op) {
+    return op == '*' ? 2 : 1;
 }
 
 /**
- * Parses something with no immediate `+` or `*` from `in`.
- * @param in input stream to be parsed.
- * @return Expression parsed from input stream.
+ * Combines the last two operands of `frame` with its last operator.
+ * @param frame frame with at least one operator and two operands.
  */
-static PTR(Expression) parseInner(std::istream &in) {
-    PTR(Expression) e = nullptr;
-
-    char c = peekAfterSpaces(in);
-    if (c == '(') {
-        e = parseOpenParen(in);
-    } else if (c == '_') {
-        e = parseUnderScore(in);
-    } else if (isdigit(c) || c == '-') {
-        e = parseNumber(in);
-    } else if (isalpha(c)) {
-        e = parseVariable(in);
-    } else {
-        throw std::runtime_error((std::string) "expected a digit or open parenthesis at " + c);
-    }
-    return e;
+static void reduceTop(ParseFrame &frame) {
+    PTR(Expression) rhs = frame.operands.back();
+    frame.operands.pop_back();
+    PTR(Expression) lhs = frame.operands.back();
+    frame.operands.pop_back();
+    char op = frame.operators.back();
+    frame.operators.pop_back();
+
+    if (op == '+')
+        frame.operands.push_back(NEW(AddExpression)(lhs, rhs));
+    else if (op == '*')
+        frame.operands.push_back(NEW(MultiplyExpression)(lhs, rhs));
+    else
+        frame.operands.push_back(NEW(EqualsExpression)(lhs, rhs));
 }
 
-PTR(Expression) parseOpenParen(std::istream &in) {
+/**
+ * Parses the `(var)` of a `_fun`.
+ * @param in input stream positioned just after `_fun`.
+ * @return VariableExpression naming the formal argument.
+ */
+static PTR(Expression) parseParameter(std::istream &in) {
+    if (peekAfterSpaces(in) != '(')
+        throw std::runtime_error("expected an open parenthesis after _fun");
     in.get();
-    PTR(Expression) e = parseExpr(in);
-    char c = peekAfterSpaces(in);
-    if (c == ')') {
-        in.get();
-    } else {
+    peekAfterSpaces(in);
+    PTR(Expression) parameter = parseVariable(in);
+    if (peekAfterSpaces(in) != ')')
         throw std::runtime_error("expected a close parenthesis");
-    }
-    return e;
-}
-
-PTR(Expression) parseUnderScore(std::istream &in) {
     in.get();
-
-    std::string string = parseNextWord(in);
-
-    if (string == "let") {
-        return parseLet(in);
-    } else if (string == "true") {
-        return parseTrue(in);
-    } else if (string == "false") {
-        return parseFalse(in);
-    } else if (string == "fun") {
-        return parseFun(in);
-    } else if (string == "if") {
-        return parseIf(in);
-    } else {
-        throw std::runtime_error("unknown Expression beginning with '_'");
-    }
-}
-
-PTR(Expression) parseIf(std::istream &in) {
-    PTR(Expression) ifCondition = parseExpr(in);
-
-    PTR(Expression) thenExpression = parseThen(in);
-
-    PTR(Expression) elseExpression = parseElse(in);
-
-    return NEW(IfExpression)(ifCondition, thenExpression, elseExpression);
-}
-
-PTR(Expression) parseThen(std::istream &in) {
-    peekAfterSpaces(in);
-    if (in.get() == '_' && parseNextWord(in) == "then") {
-        peekAfterSpaces(in);
-        return parseExpr(in);
-    } else {
-        throw std::runtime_error("unknown Expression where _then is expected' ");
-    }
-}
-
-PTR(Expression) parseElse(std::istream &in) {
-    peekAfterSpaces(in);
-    if (in.get() == '_' && parseNextWord(in) == "else") {
-        peekAfterSpaces(in);
-        return parseExpr(in);
-    } else {
-        throw std::runtime_error("unknown Expression where _else is expected' ");
-    }
-}
-
-PTR(Expression) parseFun(std::istream &in) {
-    peekAfterSpaces(in);
-    PTR(Expression) functionParameter = parseOpenParen(in);
-    peekAfterSpaces(in);
-    PTR(Expression) functionBody = parseExpr(in);
-    return NEW(FunctionExpression)(functionParameter->toString(), functionBody);
-}
-
-PTR(Expression) parseFalse(std::istream &in) {
-    return NEW(BooleanExpression)(false);
-}
-
-PTR(Expression) parseTrue(std::istream &in) {
-    return NEW(BooleanExpression)(true);
+    return parameter;
 }
 
 /**
- * _let va
- * _let x = 3 _in x
- * @param in
- * @return
+ * Consumes `_keyword` from `in`.
+ * @param in input stream to be parsed.
+ * @param keyword keyword that must come next, without its `_`.
+ * @throws Throws `runtime_error` if something else comes next.
  */
-PTR(Expression) parseLet(std::istream &in) {
-    peekAfterSpaces(in);
-    PTR(Expression) var = parseVariable(in);
-
-    peekAfterSpaces(in);
-    PTR(Expression) varEquals;
-    if (in.get() == '=') {
-        varEquals = parseExpr(in);
-    } else {
-        throw std::runtime_error("unknown Expression after variable in _let ");
-    }
-
+static void expectKeyword(std::istream &in, const std::string &keyword) {
     peekAfterSpaces(in);
-    if (in.get() == '_' && parseNextWord(in) == "in") {
-        PTR(Expression) expr = parseExpr(in);
-        return NEW(LetExpression)(var->toString(), varEquals, expr);
-    } else {
-        throw std::runtime_error("unknown Expression where _in is expected' ");
-    }
+    if (!(in.get() == '_' && parseNextWord(in) == keyword))
+        throw std::runtime_error("unknown Expression where _" + keyword + " is expected' ");
 }
 
+
 /**
  * Parses a number, assuming that `in` starts with a digit.
  * @param in istream
@@ -267,6 +321,11 @@ static std::string parseNextWord(std::istream &in) {
     return word;
 }
 
+PTR(Expression) parseSource(const std::string &source) {
+    std::istringstream in(source);
+    return parse(in);
+}
+
 /* for tests */
 static PTR(Expression) parseStr(const std::string &s) {
     std::istringstream in(s);
@@ -757,3 +816,28 @@ TEST_CASE("countUp") {
                                        "_else 1 + count(count)(n + -1)\n"
                                        "_in count(count)(100000)"))->toString() == "100000");
 }
+
+TEST_CASE("deep and long inputs") {
+    std::string parens = std::string(1000000, '(') + "1" + std::string(1000000, ')');
+    CHECK(parseStr(parens)->equals(NEW(NumberExpression)(1)));
+    CHECK(parseStrError(std::string(1000000, '(') + "1") == "expected a close parenthesis");
+
+    std::string sum = "1";
+    for (int i = 1; i < 10000; i++)
+        sum += " + 1";
+    CHECK(Step::interpBySteps(parseStr(sum))->toString() == "10000");
+
+    /* a million terms: parsing, stepping and tearing the tree down all need bounded native stack */
+    std::string longSum = "1";
+    for (int i = 1; i < 1000000; i++)
+        longSum += " + 1";
+    PTR(Expression) longTree = parseStr(longSum);
+    CHECK(Step::interpBySteps(longTree)->toString() == "1000000");
+    longTree = nullptr;
+
+    CHECK(parseStr("1 + 2 == 3")->equals(NEW(AddExpression)(NEW(NumberExpression)(1),
+                                                            NEW(EqualsExpression)(NEW(NumberExpression)(2),
+                                                                                  NEW(NumberExpression)(3)))));
+    CHECK(parseStr("1 * 2 * 3 + 4")->toString() == "((1 * (2 * 3)) + 4)");
+    CHECK(parseStr("f(1)(2 + 3)")->toString() == "f(1)((2 + 3))");
+}
@@ -0,0 +1,181 @@
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+#include "perf.h"
+#include "parse.h"
+#include "Environment.h"
+#include "expression.hpp"
+#include "../catch/catch.hpp"
+
+static const char *counterNames[PerfCounters::counterKinds] = {
+        "cycles", "instructions", "cache_misses", "branch_misses"
+};
+
+PerfCounters::Sample::Sample() : wallNanos(0) {
+    for (long &count : counts)
+        count = -1;
+}
+
+double PerfCounters::Sample::ipc() const {
+    if (counts[Cycles] <= 0 || counts[Instructions] < 0)
+        return 0;
+    return (double) counts[Instructions] / counts[Cycles];
+}
+
+PerfCounters::PerfCounters() : opened(std::chrono::steady_clock::now()) {
+    for (int &fd : fds)
+        fd = -1;
+#ifdef __linux__
+    static const unsigned long long configs[counterKinds] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+    };
+    for (int kind = 0; kind < counterKinds; kind++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[kind];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        fds[kind] = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fds[kind] < 0 && reason.empty())
+            reason = std::string(counterNames[kind]) + ": " + strerror(errno);
+    }
+#else
+    reason = "perf_event_open needs Linux";
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+    for (int fd : fds) {
+        if (fd >= 0)
+            close(fd);
+    }
+}
+
+bool PerfCounters::available() const {
+    for (int fd : fds) {
+        if (fd >= 0)
+            return true;
+    }
+    return false;
+}
+
+const std::string &PerfCounters::unavailableReason() const {
+    return reason;
+}
+
+PerfCounters::Sample PerfCounters::read() const {
+    Sample sample;
+    sample.wallNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - opened).count();
+    for (int kind = 0; kind < counterKinds; kind++) {
+        /* value, time enabled, time running; scaled up if the kernel multiplexed the counter */
+        unsigned long long values[3];
+        if (fds[kind] < 0 || ::read(fds[kind], values, sizeof(values)) != (ssize_t) sizeof(values))
+            continue;
+        if (values[2] > 0 && values[2] < values[1])
+            values[0] = (unsigned long long) ((double) values[0] * values[1] / values[2]);
+        sample.counts[kind] = (long) values[0];
+    }
+    return sample;
+}
+
+PerfCounters::Phase::Phase(PerfCounters &counters, const std::string &name)
+        : counters(counters), name(name), begin(counters.read()) {
+}
+
+PerfCounters::Phase::~Phase() {
+    counters.add(name, begin, counters.read());
+}
+
+void PerfCounters::add(const std::string &name, const Sample &begin, const Sample &end) {
+    Sample *total = nullptr;
+    for (std::pair<std::string, Sample> &phase : phaseCounts) {
+        if (phase.first == name)
+            total = &phase.second;
+    }
+    if (total == nullptr) {
+        phaseCounts.emplace_back(name, Sample());
+        total = &phaseCounts.back().second;
+        total->wallNanos = 0;
+        for (int kind = 0; kind < counterKinds; kind++)
+            total->counts[kind] = end.counts[kind] < 0 ? -1 : 0;
+    }
+    total->wallNanos += end.wallNanos - begin.wallNanos;
+    for (int kind = 0; kind < counterKinds; kind++) {
+        if (total->counts[kind] >= 0 && end.counts[kind] >= 0)
+            total->counts[kind] += end.counts[kind] - begin.counts[kind];
+    }
+}
+
+const std::vector<std::pair<std::string, PerfCounters::Sample>> &PerfCounters::phases() const {
+    return phaseCounts;
+}
+
+std::string PerfCounters::report() const {
+    std::ostringstream out;
+    out << "phase wall_ns cycles instructions ipc cache_misses branch_misses\n";
+    for (const std::pair<std::string, Sample> &phase : phaseCounts) {
+        const Sample &sample = phase.second;
+        out << phase.first << " " << sample.wallNanos;
+        for (int kind : {Cycles, Instructions}) {
+            out << " ";
+            if (sample.counts[kind] < 0)
+                out << "-";
+            else
+                out << sample.counts[kind];
+        }
+        out << " ";
+        if (sample.ipc() > 0)
+            out << sample.ipc();
+        else
+            out << "-";
+        for (int kind : {CacheMisses, BranchMisses}) {
+            out << " ";
+            if (sample.counts[kind] < 0)
+                out << "-";
+            else
+                out << sample.counts[kind];
+        }
+        out << "\n";
+    }
+    if (!reason.empty())
+        out << "# perf counters unavailable: " << reason << "\n";
+    return out.str();
+}
+
+TEST_CASE("perf counters") {
+    PerfCounters counters;
+    for (int i = 0; i < 2; i++) {
+        PTR(Expression) program;
+        {
+            PerfCounters::Phase phase(counters, "parse");
+            std::istringstream in("_let x = 5 _in x * x + 1");
+            program = parse(in);
+        }
+        PerfCounters::Phase phase(counters, "evaluate");
+        CHECK(program->interpret(Environment::empty())->toString() == "26");
+    }
+
+    REQUIRE(counters.phases().size() == 2);
+    CHECK(counters.phases()[0].first == "parse");
+    CHECK(counters.phases()[1].first == "evaluate");
+    CHECK(counters.phases()[1].second.wallNanos > 0);
+    if (counters.available())
+        CHECK(counters.phases()[1].second.counts[PerfCounters::Instructions] > 0);
+    else
+        CHECK(counters.phases()[1].second.counts[PerfCounters::Instructions] == -1);
+
+    std::string report = counters.report();
+    CHECK(report.find("phase wall_ns cycles instructions ipc cache_misses branch_misses\nparse ") == 0);
+    CHECK(report.find("\nevaluate ") != std::string::npos);
+    CHECK((report.find("# perf counters unavailable: ") != std::string::npos) == !counters.unavailableReason().empty());
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/**
+ * Hardware performance counters for the calling thread, read around
+ * phases of work such as parsing, optimizing and evaluating, so a
+ * slow phase can be told apart as stalled on branches, on cache
+ * misses or simply executing many instructions.
+ *
+ * Counts CPU cycles, instructions, cache misses and branch misses
+ * through Linux `perf_event_open`. A counter the kernel or the
+ * hardware will not provide (no permission, a virtual machine without
+ * a PMU, not Linux at all) is left out of the report rather than
+ * treated as an error, and wall-clock time is always reported.
+ */
+class PerfCounters {
+public:
+    typedef enum {
+        Cycles,
+        Instructions,
+        CacheMisses,
+        BranchMisses,
+        counterKinds
+    } counterT;
+
+    /**
+     * Counts over one stretch of work; -1 for a counter that is not available.
+     */
+    class Sample {
+    public:
+        long counts[counterKinds];
+        long wallNanos;
+
+        Sample();
+
+        /**
+         * @return instructions per cycle, or 0 if either is unavailable.
+         */
+        double ipc() const;
+    };
+
+    PerfCounters();
+
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters &) = delete;
+
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    /**
+     * @return whether any hardware counter could be opened.
+     */
+    bool available() const;
+
+    /**
+     * @return why the counters that are missing could not be opened.
+     */
+    const std::string &unavailableReason() const;
+
+    /**
+     * @return the counts since these counters were opened.
+     */
+    Sample read() const;
+
+    /**
+     * Adds the counts from construction to destruction to `counters`
+     * under `name`, summing repeated phases of the same name.
+     */
+    class Phase {
+    public:
+        Phase(PerfCounters &counters, const std::string &name);
+
+        ~Phase();
+
+    private:
+        PerfCounters &counters;
+        std::string name;
+        Sample begin;
+    };
+
+    /**
+     * @return a `phase wall_ns cycles instructions ipc cache_misses
+     * branch_misses` header, then one such line per phase with `-` for
+     * counters that are not available, then a `#` line saying why if
+     * any are not.
+     */
+    std::string report() const;
+
+    /**
+     * @return each phase's name and summed counts, in first-seen order.
+     */
+    const std::vector<std::pair<std::string, Sample>> &phases() const;
+
+private:
+    int fds[counterKinds];
+    std::string reason;
+    std::chrono::steady_clock::time_point opened;
+    std::vector<std::pair<std::string, Sample>> phaseCounts;
+
+    void add(const std::string &name, const Sample &begin, const Sample &end);
+};
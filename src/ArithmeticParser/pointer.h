@@ -14,7 +14,8 @@
 # define ENABLE_THIS(T) /* empty */
 
 #else
-# define NEW(T) std::make_shared<T>
+# include "budget.h"
+# define NEW(T) makeCharged<T>
 # define PTR(T) std::shared_ptr<T>
 # define CAST(T) std::dynamic_pointer_cast<T>
 # define THIS std::shared_from_this()
@@ -0,0 +1,135 @@
+#include "pool.h"
+
+#include <chrono>
+
+/* the pool and queue index of the worker running on this thread, if any */
+static thread_local WorkStealingPool *currentPool = nullptr;
+static thread_local int currentWorker = -1;
+
+/* how many times an idle worker yields before it parks on `wakeUp` */
+static const int spinsBeforeParking = 16;
+
+WorkStealingPool::WorkStealingPool(int workers) : queued(0), nextQueue(0), sleepers(0), stopping(false) {
+    if (workers < 1)
+        workers = 1;
+    for (int i = 0; i < workers; i++)
+        queues.emplace_back(new Queue());
+    for (int i = 0; i < workers; i++)
+        threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    shutdown();
+}
+
+void WorkStealingPool::shutdown() {
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (std::thread &thread : threads) {
+        if (thread.joinable())
+            thread.join();
+    }
+}
+
+void WorkStealingPool::submit(std::function<void()> task) {
+    int index = currentPool == this
+                ? currentWorker
+                : static_cast<int>(nextQueue++ % queues.size());
+    {
+        std::lock_guard<std::mutex> guard(queues[index]->lock);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    /*
+     * a worker counts itself asleep before it last looks at `queued`,
+     * and this looks at `sleepers` after counting the task, so either
+     * the worker sees the task or this sees the worker
+     */
+    queued++;
+    if (sleepers.load() == 0)
+        return;
+    {
+        /* taking the lock orders this wake-up after a sleeping worker's last check */
+        std::lock_guard<std::mutex> guard(sleepLock);
+    }
+    wakeUp.notify_one();
+}
+
+bool WorkStealingPool::runPendingTask() {
+    std::function<void()> task;
+    if (!takeTask(currentPool == this ? currentWorker : 0, task))
+        return false;
+    task();
+    return true;
+}
+
+int WorkStealingPool::defaultWorkerCount() {
+    unsigned cores = std::thread::hardware_concurrency();
+    return cores == 0 ? 1 : static_cast<int>(cores);
+}
+
+void WorkStealingPool::workerLoop(int index) {
+    currentPool = this;
+    currentWorker = index;
+
+    int misses = 0;
+    while (true) {
+        std::function<void()> task;
+        if (takeTask(index, task)) {
+            misses = 0;
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(sleepLock);
+        if (queued.load() > 0) {
+            /*
+             * a task is counted but every queue looked empty, so another
+             * thread is between taking it and uncounting it; yield a few
+             * times, then park briefly rather than spin on the queues
+             */
+            if (++misses < spinsBeforeParking) {
+                guard.unlock();
+                std::this_thread::yield();
+            } else {
+                wakeUp.wait_for(guard, std::chrono::microseconds(100));
+            }
+            continue;
+        }
+        misses = 0;
+        if (stopping)
+            return;
+        sleepers++;
+        wakeUp.wait(guard, [this] { return stopping || queued.load() > 0; });
+        sleepers--;
+    }
+}
+
+/**
+ * Pops the newest task of queue `index`, or else steals the oldest
+ * task of the first other queue that has one.
+ */
+bool WorkStealingPool::takeTask(int index, std::function<void()> &task) {
+    if (queued.load() == 0)
+        return false;
+
+    int count = static_cast<int>(queues.size());
+    for (int i = 0; i < count; i++) {
+        Queue &queue = *queues[(index + i) % count];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.tasks.empty())
+            continue;
+        if (i == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        queued--;
+        return true;
+    }
+    return false;
+}
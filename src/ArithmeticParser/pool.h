@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed set of worker threads, each with its own task queue.
+ * A worker runs the newest task from its own queue first and, when
+ * that queue is empty, steals the oldest task from another worker's
+ * queue, so workers only contend when they actually run out of work.
+ */
+class WorkStealingPool {
+public:
+    /**
+     * Starts `workers` threads (at least one).
+     */
+    explicit WorkStealingPool(int workers);
+
+    /**
+     * Runs every task that is still queued, then joins the workers.
+     */
+    ~WorkStealingPool();
+
+    /**
+     * Does what the destructor does, so an owner can drain the pool
+     * before tearing down state its tasks still use. Later calls, and
+     * the destructor, then do nothing.
+     */
+    void shutdown();
+
+    /**
+     * Queues `task`. A task submitted from one of this pool's workers
+     * goes on that worker's own queue; otherwise queues are filled
+     * round-robin.
+     */
+    void submit(std::function<void()> task);
+
+    /**
+     * Runs one queued task on the calling thread, if there is one, so
+     * a thread waiting for other tasks can help instead of blocking.
+     * A worker prefers the newest task on its own queue.
+     * @return whether a task was run.
+     */
+    bool runPendingTask();
+
+    /**
+     * @return the number of threads to use when the caller does not say.
+     */
+    static int defaultWorkerCount();
+
+private:
+    class Queue {
+    public:
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<long> queued;
+    std::atomic<unsigned> nextQueue;
+
+    std::mutex sleepLock;
+    std::condition_variable wakeUp;
+    std::atomic<int> sleepers; /* workers waiting on `wakeUp` for work; `submit` only wakes one then */
+    bool stopping;
+
+    void workerLoop(int index);
+
+    bool takeTask(int index, std::function<void()> &task);
+};
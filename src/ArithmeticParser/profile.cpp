@@ -0,0 +1,237 @@
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include <sys/time.h>
+#include "profile.h"
+#include "expression.hpp"
+#include "parse.h"
+#include "step.h"
+#include "Environment.h"
+#include "../catch/catch.hpp"
+
+std::atomic<bool> Profiler::active(false);
+thread_local Profiler::ShadowStack Profiler::stack;
+
+/* frame names by id; ids 0 and 1 are "unnamed" and the steps frame */
+static std::mutex labelsLock;
+static std::vector<std::string> labels = {"?", "(steps)"};
+static std::unordered_map<std::string, int> labelIds;
+
+/*
+ * Each sample is a frame count, a truncated flag and `sampleDepth`
+ * frame ids, outermost first. The count is written last and is -1
+ * until then. A buffer is only freed by the next `start`, so a
+ * handler still running when `stop` returns writes into live memory.
+ */
+static const int recordSize = Profiler::sampleDepth + 2;
+static std::atomic<int *> samples(nullptr);
+static std::atomic<long> sampleCount(0);
+static long sampleCapacity = 0;
+static struct sigaction previousAction;
+
+void Profiler::start(std::chrono::microseconds interval, long capacity) {
+    if (active)
+        throw std::runtime_error("profiler already running");
+    if (capacity < 1)
+        capacity = 1;
+
+    int *buffer = new int[capacity * recordSize];
+    for (long i = 0; i < capacity; i++)
+        buffer[i * recordSize] = -1;
+    delete[] samples.exchange(buffer);
+    sampleCapacity = capacity;
+    sampleCount = 0;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = sample;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, &previousAction) != 0)
+        throw std::runtime_error(std::string("sigaction: ") + strerror(errno));
+
+    active = true;
+    long micros = interval.count() > 0 ? interval.count() : 1;
+    struct itimerval timer;
+    timer.it_interval.tv_sec = micros / 1000000;
+    timer.it_interval.tv_usec = micros % 1000000;
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+        active = false;
+        sigaction(SIGPROF, &previousAction, nullptr);
+        throw std::runtime_error(std::string("setitimer: ") + strerror(errno));
+    }
+}
+
+std::string Profiler::stop() {
+    if (!active)
+        return "";
+    struct itimerval off;
+    memset(&off, 0, sizeof(off));
+    setitimer(ITIMER_PROF, &off, nullptr);
+    /*
+     * hand SIGPROF back to the host's handler, if it has one; a signal
+     * still pending from the timer would kill the process under SIG_DFL
+     */
+    bool hostDefault = !(previousAction.sa_flags & SA_SIGINFO) && previousAction.sa_handler == SIG_DFL;
+    if (hostDefault) {
+        struct sigaction ignore = previousAction;
+        ignore.sa_handler = SIG_IGN;
+        sigaction(SIGPROF, &ignore, nullptr);
+    } else {
+        sigaction(SIGPROF, &previousAction, nullptr);
+    }
+    active = false;
+
+    std::map<std::string, long> folded;
+    long taken = sampleCount;
+    long kept = taken < sampleCapacity ? taken : sampleCapacity;
+    int *buffer = samples;
+    {
+        std::lock_guard<std::mutex> guard(labelsLock);
+        for (long i = 0; i < kept; i++) {
+            const int *record = buffer + i * recordSize;
+            int count = __atomic_load_n(record, __ATOMIC_ACQUIRE);
+            if (count < 0)
+                continue;
+            std::string stackText = "program";
+            if (record[1])
+                stackText += ";...";
+            for (int frame = 0; frame < count; frame++) {
+                int id = record[2 + frame];
+                stackText += ";" + labels[id >= 0 && id < (int) labels.size() ? id : 0];
+            }
+            folded[stackText]++;
+        }
+    }
+
+    std::ostringstream out;
+    for (const auto &entry : folded)
+        out << entry.first << " " << entry.second << "\n";
+    if (taken > kept)
+        out << "# dropped " << taken - kept << "\n";
+    return out.str();
+}
+
+/**
+ * @return the id of the frame name for `site`, naming it on first use.
+ */
+int Profiler::siteId(CallExpression *site) {
+    int id = site->profileSite.load(std::memory_order_relaxed);
+    if (id != 0)
+        return id;
+
+    std::string label;
+    auto variable = std::dynamic_pointer_cast<VariableExpression>(site->toBeCalled);
+    if (variable != nullptr) {
+        label = variable->name;
+    } else {
+        label = site->toBeCalled->toString();
+        if (label.size() > 40)
+            label = label.substr(0, 37) + "...";
+    }
+    for (char &c : label) {
+        if (c == ';' || c == '\n')
+            c = ' ';
+    }
+
+    std::lock_guard<std::mutex> guard(labelsLock);
+    auto found = labelIds.find(label);
+    if (found != labelIds.end()) {
+        id = found->second;
+    } else {
+        id = (int) labels.size();
+        labels.push_back(label);
+        labelIds[label] = id;
+    }
+    site->profileSite.store(id, std::memory_order_relaxed);
+    return id;
+}
+
+/**
+ * The `SIGPROF` handler: copies the interrupted thread's shadow stack
+ * into the next free sample. Async-signal-safe, as it only touches
+ * plain memory and lock-free atomics.
+ */
+void Profiler::sample(int) {
+    int savedErrno = errno;
+    long slot = sampleCount.fetch_add(1, std::memory_order_relaxed);
+    int *buffer = samples.load(std::memory_order_relaxed);
+    if (slot < sampleCapacity && buffer != nullptr) {
+        int *record = buffer + slot * recordSize;
+        int depth = stack.depth;
+        std::atomic_signal_fence(std::memory_order_acquire);
+        if (depth > maxDepth)
+            depth = maxDepth;
+        int first = depth > sampleDepth ? depth - sampleDepth : 0;
+        record[1] = first > 0;
+        for (int frame = first; frame < depth; frame++)
+            record[2 + frame - first] = stack.frames[frame];
+        __atomic_store_n(record, depth - first, __ATOMIC_RELEASE);
+    }
+    errno = savedErrno;
+}
+
+TEST_CASE("sampling profiler") {
+    std::istringstream in("_let fib = _fun (fib)\n"
+                          "  _fun (x)\n"
+                          "    _if x == 0 _then 1\n"
+                          "    _else _if x == 1 _then 1\n"
+                          "    _else fib(fib)(x + -2) + fib(fib)(x + -1)\n"
+                          "_in fib(fib)(18)");
+    PTR(Expression) program = parse(in);
+
+    CHECK(Profiler::stop() == "");
+    Profiler::start(std::chrono::microseconds(200));
+    CHECK_THROWS(Profiler::start());
+    auto started = std::chrono::steady_clock::now();
+    do {
+        CHECK(program->interpret(Environment::empty())->toString() == "4181");
+        CHECK(Step::interpBySteps(program)->toString() == "4181");
+    } while (std::chrono::steady_clock::now() - started < std::chrono::milliseconds(300));
+    std::string folded = Profiler::stop();
+
+    CHECK(folded.find("program;fib(fib);fib(fib)") != std::string::npos);
+    CHECK(folded.find("program;(steps) ") != std::string::npos);
+    CHECK(folded.find("# dropped") == std::string::npos);
+    std::istringstream lines(folded);
+    std::string line;
+    while (std::getline(lines, line)) {
+        CHECK(line.compare(0, 7, "program") == 0);
+        CHECK(line.rfind(' ') != std::string::npos);
+    }
+}
+
+static void hostHandler(int) {
+}
+
+TEST_CASE("profiler restores the host's SIGPROF handler") {
+    struct sigaction host;
+    memset(&host, 0, sizeof(host));
+    host.sa_handler = hostHandler;
+    sigemptyset(&host.sa_mask);
+    struct sigaction saved;
+    sigaction(SIGPROF, &host, &saved);
+
+    Profiler::start();
+    Profiler::stop();
+    struct sigaction after;
+    sigaction(SIGPROF, nullptr, &after);
+    CHECK(after.sa_handler == hostHandler);
+
+    /* without a host handler a late SIGPROF is ignored rather than fatal */
+    host.sa_handler = SIG_DFL;
+    sigaction(SIGPROF, &host, nullptr);
+    Profiler::start();
+    Profiler::stop();
+    sigaction(SIGPROF, nullptr, &after);
+    CHECK(after.sa_handler == SIG_IGN);
+    raise(SIGPROF);
+
+    sigaction(SIGPROF, &saved, nullptr);
+}
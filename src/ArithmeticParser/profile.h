@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <string>
+
+class CallExpression;
+
+/**
+ * A sampling profiler for MSDScript functions.
+ *
+ * While it runs, `CallExpression::interpret` pushes a `Frame` for its
+ * call site onto a per-thread shadow stack for the length of the call,
+ * and `Step::run` pushes one `(steps)` frame for the whole run, since
+ * step mode calls do not nest on the native stack. A `SIGPROF` timer
+ * copies the shadow stack of whichever thread it interrupts into a
+ * preallocated sample buffer. `stop` turns the samples into folded
+ * stacks, one `program;outer;inner count` line per distinct stack,
+ * which flame graph tools such as `flamegraph.pl` render directly.
+ *
+ * A frame is named after its call site: the variable called, such as
+ * `fib`, or the called expression's text. Pushing a frame is a flag
+ * test and a thread-local store, and nothing at all while stopped.
+ * Only the outermost `maxDepth` frames of a thread are kept, and a
+ * sample records the innermost `sampleDepth` of those.
+ */
+class Profiler {
+public:
+    static const int maxDepth = 1024;
+    static const int sampleDepth = 64;
+
+    /**
+     * Starts sampling every `interval` of process CPU time.
+     * @param capacity samples to keep; later ones are counted as dropped.
+     * @throws Throws `runtime_error` if a profile is already running.
+     */
+    static void start(std::chrono::microseconds interval = std::chrono::microseconds(1000),
+                      long capacity = 1L << 16);
+
+    /**
+     * Stops sampling and gives `SIGPROF` back to the handler the host
+     * had, or ignores it if the host had none.
+     * @return the folded stacks, followed by a `# dropped n` line if
+     * the buffer filled up.
+     */
+    static std::string stop();
+
+    /**
+     * A call site on this thread's shadow stack from construction to
+     * destruction.
+     */
+    class Frame {
+    public:
+        explicit Frame(CallExpression *site) : pushed(active.load(std::memory_order_relaxed)) {
+            if (pushed)
+                push(siteId(site));
+        }
+
+        /**
+         * The frame of a whole `Step::run`.
+         */
+        Frame() : pushed(active.load(std::memory_order_relaxed)) {
+            if (pushed)
+                push(stepsId);
+        }
+
+        ~Frame() {
+            if (pushed) {
+                stack.depth--;
+                std::atomic_signal_fence(std::memory_order_release);
+            }
+        }
+
+        Frame(const Frame &) = delete;
+
+        Frame &operator=(const Frame &) = delete;
+
+    private:
+        bool pushed;
+    };
+
+private:
+    static const int stepsId = 1;
+
+    /* plain data, so the signal handler may read it */
+    struct ShadowStack {
+        int depth;
+        int frames[maxDepth];
+    };
+
+    static std::atomic<bool> active;
+    static thread_local ShadowStack stack;
+
+    static void push(int id) {
+        int depth = stack.depth;
+        if (depth < maxDepth)
+            stack.frames[depth] = id;
+        std::atomic_signal_fence(std::memory_order_release);
+        stack.depth = depth + 1;
+    }
+
+    static int siteId(CallExpression *site);
+
+    static void sample(int signal);
+};
@@ -0,0 +1,311 @@
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include "program.h"
+#include "parse.h"
+#include "Environment.h"
+#include "step.h"
+#include "pool.h"
+#include "cache.h"
+#include "budget.h"
+#include "cost.h"
+#include "trace.h"
+#include <algorithm>
+#include "../catch/catch.hpp"
+
+bool Program::modeFromFlag(const char *flag, modeT &mode) {
+    if (strcmp(flag, "-interp") == 0) {
+        mode = InterpMode;
+    } else if (strncmp(flag, "-opt", 4) == 0) {
+        mode = OptimizeMode;
+    } else if (strcmp(flag, "-step") == 0) {
+        mode = StepMode;
+    } else if (strcmp(flag, "-auto") == 0) {
+        mode = AutoMode;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+long Program::fuelLimit = -1;
+std::chrono::milliseconds Program::timeLimit(0);
+long Program::memoryLimit = -1;
+
+void Program::setLimits(long fuel, std::chrono::milliseconds timeout, long memory) {
+    fuelLimit = fuel;
+    timeLimit = timeout;
+    memoryLimit = memory;
+}
+
+PTR(Budget) Program::budget(const std::atomic<bool> *cancel) {
+    if (fuelLimit < 0 && timeLimit.count() <= 0 && memoryLimit < 0 && cancel == nullptr)
+        return nullptr;
+    return NEW(Budget)(fuelLimit, timeLimit, cancel, memoryLimit);
+}
+
+std::string Program::evaluate(modeT mode, PTR(Expression) e, const std::atomic<bool> *cancel, long *peakBytes) {
+    PTR(Budget) limits = budget(cancel);
+    if (limits == nullptr && peakBytes != nullptr)
+        limits = NEW(Budget)(-1, std::chrono::milliseconds(0));
+    std::string result;
+    {
+        Budget::Scope scope(limits.get());
+        if (mode == AutoMode)
+            mode = CostEstimate(e).engine();
+        switch (mode) {
+            case StepMode: {
+                Tracer::Span span("evaluate step");
+                result = Step::interpBySteps(e)->toString();
+                break;
+            }
+            case OptimizeMode: {
+                Tracer::Span span("optimize");
+                result = e->optimize()->toString();
+                break;
+            }
+            default: {
+                Tracer::Span span("evaluate interp");
+                result = e->interpret(NEW(EmptyEnv)())->toString();
+                break;
+            }
+        }
+    }
+    if (peakBytes != nullptr)
+        *peakBytes = limits->peakBytes();
+    return result;
+}
+
+std::string Program::run(modeT mode, std::istream &in) {
+    return evaluate(mode, parse(in));
+}
+
+std::string Program::run(modeT mode, const std::string &source, ProgramCache *cache) {
+    if (cache != nullptr)
+        return cache->run(mode, source);
+    std::istringstream in(source);
+    return run(mode, in);
+}
+
+int Program::stream(modeT mode, std::istream &in, std::ostream &out, std::ostream &err, char delimiter,
+                    ProgramCache *cache) {
+    int failures = 0;
+    long programNumber = 0;
+    std::string text;
+    std::istringstream programIn;
+
+    while (std::getline(in, text, delimiter)) {
+        if (text.find_first_not_of(" \t\r\n") == std::string::npos)
+            continue;
+        programNumber++;
+
+        try {
+            if (cache != nullptr) {
+                out << cache->run(mode, text) << '\n';
+            } else {
+                /* reuse one stream so each program costs no stream construction */
+                programIn.clear();
+                programIn.str(text);
+                out << run(mode, programIn) << '\n';
+            }
+        } catch (std::runtime_error &exn) {
+            failures++;
+            err << "program " << programNumber << ": " << exn.what() << '\n';
+        }
+    }
+    return failures;
+}
+
+int Program::batch(modeT mode, std::istream &in, std::ostream &out, std::ostream &err, char delimiter, int jobs,
+                   ProgramCache *cache, double maxCost) {
+    std::vector<std::string> programs;
+    std::string text;
+    while (std::getline(in, text, delimiter)) {
+        if (text.find_first_not_of(" \t\r\n") != std::string::npos)
+            programs.push_back(text);
+    }
+
+    /* the reorder buffer: one slot per program, written in order as the prefix completes */
+    std::vector<std::string> results(programs.size());
+    std::vector<bool> failed(programs.size(), false);
+    std::vector<bool> finished(programs.size(), false);
+    std::mutex lock;
+    std::condition_variable resultReady;
+
+    auto finish = [&](size_t i, std::string result, bool programFailed) {
+        std::lock_guard<std::mutex> guard(lock);
+        results[i] = std::move(result);
+        failed[i] = programFailed;
+        finished[i] = true;
+        resultReady.notify_one();
+    };
+
+    std::vector<PTR(Expression)> parsed(programs.size());
+    std::vector<double> costs(programs.size(), 0);
+    size_t estimated = 0;
+    std::condition_variable allEstimated;
+
+    /* declared after everything its tasks use, so it is joined before they go */
+    WorkStealingPool pool(jobs);
+
+    /*
+     * first parse and estimate every program, in parallel, a chunk per
+     * task; programs without recursion take time linear in their size,
+     * so they are evaluated right away and only recursive ones deferred
+     */
+    size_t chunk = std::max<size_t>(1, programs.size() / (static_cast<size_t>(jobs) * 8 + 1));
+    for (size_t start = 0; start < programs.size(); start += chunk) {
+        size_t end = std::min(programs.size(), start + chunk);
+        pool.submit([&, start, end] {
+            std::istringstream programIn;
+            for (size_t i = start; i < end; i++) {
+                try {
+                    if (cache != nullptr) {
+                        parsed[i] = cache->parsed(programs[i]);
+                    } else {
+                        programIn.clear();
+                        programIn.str(programs[i]);
+                        parsed[i] = parse(programIn);
+                    }
+                    CostEstimate estimate(parsed[i]);
+                    costs[i] = estimate.cost();
+                    if (maxCost >= 0 && costs[i] > maxCost) {
+                        parsed[i] = nullptr;
+                        finish(i, "rejected: estimated cost exceeds limit", true);
+                    } else if (!estimate.recursive()) {
+                        PTR(Expression) e = std::move(parsed[i]);
+                        if (mode == OptimizeMode && cache != nullptr)
+                            finish(i, cache->run(mode, programs[i]), false);
+                        else
+                            finish(i, evaluate(mode, e), false);
+                    }
+                } catch (std::exception &exn) {
+                    /* a bad_alloc or the like fails this program, not the batch */
+                    parsed[i] = nullptr;
+                    finish(i, exn.what(), true);
+                } catch (...) {
+                    parsed[i] = nullptr;
+                    finish(i, "unknown error", true);
+                }
+            }
+            std::lock_guard<std::mutex> guard(lock);
+            estimated += end - start;
+            if (estimated == programs.size())
+                allEstimated.notify_one();
+        });
+    }
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        allEstimated.wait(guard, [&] { return estimated == programs.size(); });
+    }
+
+    /* then start the deferred ones most expensive first */
+    std::vector<size_t> order;
+    for (size_t i = 0; i < programs.size(); i++) {
+        if (parsed[i] != nullptr)
+            order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&costs](size_t a, size_t b) { return costs[a] > costs[b]; });
+    for (size_t i : order) {
+        pool.submit([&, i] {
+            /* once the last program finishes, `batch` may return */
+            PTR(Expression) e = std::move(parsed[i]);
+            try {
+                if (mode == OptimizeMode && cache != nullptr)
+                    finish(i, cache->run(mode, programs[i]), false);
+                else
+                    finish(i, evaluate(mode, e), false);
+            } catch (std::exception &exn) {
+                finish(i, exn.what(), true);
+            } catch (...) {
+                finish(i, "unknown error", true);
+            }
+        });
+    }
+
+    int failures = 0;
+    for (size_t next = 0; next < programs.size(); next++) {
+        std::string result;
+        bool programFailed;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            resultReady.wait(guard, [&] { return finished[next]; });
+            result = std::move(results[next]);
+            programFailed = failed[next];
+        }
+        if (programFailed) {
+            failures++;
+            err << "program " << next + 1 << ": " << result << '\n';
+        } else {
+            out << result << '\n';
+        }
+    }
+    return failures;
+}
+
+TEST_CASE("stream programs") {
+    std::istringstream in("1 + 2\n\n_let x = 3 _in x * x\ny\n_if 1 == 1 _then 4 _else 5\n");
+    std::ostringstream out;
+    std::ostringstream err;
+    CHECK(Program::stream(Program::InterpMode, in, out, err, '\n') == 1);
+    CHECK(out.str() == "3\n9\n4\n");
+    CHECK(err.str() == "program 3: free variable: y\n");
+
+    std::istringstream stepIn("_fun (x)\n x + 1 ; 2 * 3;1 +");
+    std::ostringstream stepOut;
+    std::ostringstream stepErr;
+    CHECK(Program::stream(Program::StepMode, stepIn, stepOut, stepErr, ';') == 1);
+    CHECK(stepOut.str() == "_fun (x) (x + 1)\n6\n");
+
+    std::istringstream optIn("x + 1 + 1");
+    std::ostringstream optOut;
+    CHECK(Program::stream(Program::OptimizeMode, optIn, optOut, optOut, '\n') == 0);
+    CHECK(optOut.str() == "(x + 2)\n");
+}
+
+TEST_CASE("batch programs keep input order") {
+    std::string fib = "_let fib = _fun (fib) _fun (x)"
+                      " _if x == 0 _then 1"
+                      " _else _if x == 1 _then 1"
+                      " _else fib(fib)(x + -1) + fib(fib)(x + -2)"
+                      " _in fib(fib)(";
+    std::string programs;
+    std::string expected;
+    int fibs[] = {1, 1, 2, 3, 5, 8, 13, 21, 34, 55, 89, 144};
+    for (int i = 0; i < 200; i++) {
+        programs += fib + std::to_string(i % 12) + ")\n";
+        expected += std::to_string(fibs[i % 12]) + "\n";
+    }
+    programs += "1 + _true\n";
+
+    for ([[maybe_unused]] Program::modeT mode : {Program::InterpMode, Program::StepMode}) {
+        std::istringstream in(programs);
+        std::ostringstream out;
+        std::ostringstream err;
+        CHECK(Program::batch(mode, in, out, err, '\n', 4) == 1);
+        CHECK(out.str() == expected);
+        CHECK(err.str() == "program 201: not a number\n");
+    }
+}
+
+TEST_CASE("batch admission and engine choice") {
+    std::string count = "_let count = _fun(count) _fun(n)"
+                        " _if n == 0 _then 0 _else 1 + count(count)(n + -1)"
+                        " _in count(count)(";
+    std::string fib = "_let fib = _fun (fib) _fun (x)"
+                      " _if x == 0 _then 0 _else _if x == 1 _then 1"
+                      " _else fib(fib)(x + -1) + fib(fib)(x + -2)"
+                      " _in fib(fib)(10)";
+    std::istringstream in("1 + 2\n" + count + "100000)\n" + fib + "\n" + count + "3)\ny\n");
+    std::ostringstream out;
+    std::ostringstream err;
+    CHECK(Program::batch(Program::AutoMode, in, out, err, '\n', 2, nullptr, 1e6) == 2);
+    CHECK(out.str() == "3\n100000\n3\n");
+    CHECK(err.str() == "program 3: rejected: estimated cost exceeds limit\n"
+                       "program 5: free variable: y\n");
+
+    std::istringstream deep(count + "100000)");
+    CHECK(Program::run(Program::AutoMode, deep) == "100000");
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include "pointer.h"
+
+class Expression;
+
+class ProgramCache;
+
+class Budget;
+
+/**
+ * Runs whole MSDScript programs the way `main` does: parse the
+ * source text, then interpret it, interpret it by steps, or
+ * optimize it, and render the result as text. `AutoMode` interprets
+ * with whichever engine `CostEstimate::engine` picks for the program.
+ */
+class Program {
+public:
+    typedef enum {
+        InterpMode,
+        StepMode,
+        OptimizeMode,
+        AutoMode
+    } modeT;
+
+    /**
+     * @param flag command line flag such as `-interp`, `-step`, `-opt` or `-auto`.
+     * @param mode set to the mode named by `flag`.
+     * @return whether `flag` names a mode.
+     */
+    static bool modeFromFlag(const char *flag, modeT &mode);
+
+    /**
+     * Limits every later evaluation to `fuel` steps (none if negative),
+     * `timeout` of wall-clock time (none if zero) and `memory` live
+     * heap bytes (none if negative). Call it before starting any
+     * threads that evaluate programs.
+     */
+    static void setLimits(long fuel, std::chrono::milliseconds timeout, long memory = -1);
+
+    /**
+     * @return a fresh budget with the limits from `setLimits` that is
+     * also cancelled by `cancel`, or null if there is nothing to enforce.
+     */
+    static PTR(Budget) budget(const std::atomic<bool> *cancel = nullptr);
+
+    /**
+     * Evaluates an already parsed program within the limits from
+     * `setLimits`, stopping early if `cancel` becomes true.
+     * @param peakBytes if not null, set to the most heap bytes the
+     * evaluation had live at once.
+     * @return the printed result (without a trailing newline).
+     * @throws Throws `runtime_error` for evaluation errors, and
+     * `EvaluationAborted` when a limit is reached.
+     */
+    static std::string evaluate(modeT mode, PTR(Expression) e, const std::atomic<bool> *cancel = nullptr,
+                                long *peakBytes = nullptr);
+
+    /**
+     * Parses one program from `in` (which must end after it) and evaluates it.
+     * @return the printed result (without a trailing newline).
+     * @throws Throws `runtime_error` for parse and evaluation errors.
+     */
+    static std::string run(modeT mode, std::istream &in);
+
+    /**
+     * Runs the program in `source`, taking its parsed and optimized
+     * forms from `cache` unless `cache` is null.
+     * @return the printed result (without a trailing newline).
+     * @throws Throws `runtime_error` for parse and evaluation errors.
+     */
+    static std::string run(modeT mode, const std::string &source, ProgramCache *cache);
+
+    /**
+     * Reads programs separated by `delimiter` from `in` until end of file
+     * and evaluates each one, writing one result line per program to
+     * `out` and one `program N: message` line per failed program to
+     * `err`. Blank programs are skipped. Nothing is flushed per program,
+     * so the streams' own buffering decides how often output is written.
+     * Programs are looked up in `cache` first when it is not null.
+     * @return the number of programs that failed.
+     */
+    static int stream(modeT mode, std::istream &in, std::ostream &out, std::ostream &err, char delimiter,
+                      ProgramCache *cache = nullptr);
+
+    /**
+     * Like `stream`, but reads every program first and evaluates them
+     * on `jobs` threads of a `WorkStealingPool`. Results and errors are
+     * still written in input order: each finished result waits in a
+     * reorder buffer until every earlier program has been written.
+     *
+     * The programs are parsed and given a `CostEstimate` first. Those
+     * without recursion are evaluated at once; recursive ones wait
+     * until every program is estimated and are then started most
+     * expensive first, so a long program does not end up running
+     * alone at the end. A program whose estimated cost is over
+     * `maxCost` (unless it is negative) fails without running.
+     * @return the number of programs that failed.
+     */
+    static int batch(modeT mode, std::istream &in, std::ostream &out, std::ostream &err, char delimiter, int jobs,
+                     ProgramCache *cache = nullptr, double maxCost = -1);
+
+private:
+    static long fuelLimit;
+    static std::chrono::milliseconds timeLimit;
+    static long memoryLimit;
+};
@@ -0,0 +1,217 @@
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include "scheduler.h"
+#include "budget.h"
+#include "Environment.h"
+#include "continuation.h"
+#include "expression.hpp"
+#include "value.h"
+#include "parse.h"
+#include "../catch/catch.hpp"
+
+StepScheduler::StepScheduler(int workers, long stepsPerSlice)
+        : queued(0), nextQueue(0), preemptionCount(0), stopping(false) {
+    this->stepsPerSlice = stepsPerSlice < 1 ? 1 : stepsPerSlice;
+    if (workers < 1)
+        workers = 1;
+    for (int i = 0; i < workers; i++)
+        queues.emplace_back(new Queue());
+    for (int i = 0; i < workers; i++)
+        threads.emplace_back(&StepScheduler::workerLoop, this, i);
+}
+
+StepScheduler::~StepScheduler() {
+    shutdown();
+}
+
+void StepScheduler::shutdown() {
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (std::thread &thread : threads) {
+        if (thread.joinable())
+            thread.join();
+    }
+}
+
+void StepScheduler::submit(PTR(Expression) e, PTR(Environment) env, callbackT done, PTR(Budget) budget) {
+    std::unique_ptr<Evaluation> evaluation(new Evaluation());
+    evaluation->program = e;
+    evaluation->mode = Step::InterpMode;
+    evaluation->expr = std::move(e);
+    evaluation->env = std::move(env);
+    evaluation->cont = Continuation::done;
+    evaluation->done = std::move(done);
+    evaluation->budget = std::move(budget);
+    enqueue(static_cast<int>(nextQueue++ % queues.size()), std::move(evaluation));
+}
+
+long StepScheduler::preemptions() {
+    return preemptionCount;
+}
+
+void StepScheduler::enqueue(int index, std::unique_ptr<Evaluation> evaluation) {
+    {
+        std::lock_guard<std::mutex> guard(queues[index]->lock);
+        queues[index]->ready.push_back(std::move(evaluation));
+    }
+    queued++;
+    {
+        /* taking the lock orders this wake-up after a worker's last check */
+        std::lock_guard<std::mutex> guard(sleepLock);
+    }
+    wakeUp.notify_one();
+}
+
+void StepScheduler::workerLoop(int index) {
+    while (true) {
+        std::unique_ptr<Evaluation> evaluation;
+        if (takeEvaluation(index, evaluation)) {
+            runSlice(index, std::move(evaluation));
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(sleepLock);
+        if (queued.load() > 0)
+            continue;
+        if (stopping)
+            return;
+        wakeUp.wait(guard, [this] { return stopping || queued.load() > 0; });
+    }
+}
+
+/**
+ * Takes the oldest evaluation of queue `index`, or else steals the
+ * newest evaluation of the first other queue that has one.
+ */
+bool StepScheduler::takeEvaluation(int index, std::unique_ptr<Evaluation> &evaluation) {
+    if (queued.load() == 0)
+        return false;
+
+    int count = static_cast<int>(queues.size());
+    for (int i = 0; i < count; i++) {
+        Queue &queue = *queues[(index + i) % count];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.ready.empty())
+            continue;
+        if (i == 0) {
+            evaluation = std::move(queue.ready.front());
+            queue.ready.pop_front();
+        } else {
+            evaluation = std::move(queue.ready.back());
+            queue.ready.pop_back();
+        }
+        queued--;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Loads `evaluation` into this thread's `Step` registers and runs one
+ * slice of it, then either reports its outcome or saves the registers
+ * and queues it again behind the evaluations already waiting.
+ */
+void StepScheduler::runSlice(int index, std::unique_ptr<Evaluation> evaluation) {
+    Step::mode = evaluation->mode;
+    Step::expr = std::move(evaluation->expr);
+    Step::env = std::move(evaluation->env);
+    Step::val = std::move(evaluation->val);
+    Step::cont = std::move(evaluation->cont);
+
+    bool finished = false;
+    bool failed = false;
+    std::string error;
+    Budget::Scope scope(evaluation->budget.get());
+    try {
+        finished = Step::run(stepsPerSlice);
+    } catch (std::exception &exn) {
+        /* a bad_alloc or the like fails this evaluation, not the worker */
+        failed = true;
+        error = exn.what();
+    } catch (...) {
+        failed = true;
+        error = "unknown error";
+    }
+
+    if (finished || failed) {
+        PTR(Value) result = failed ? nullptr : std::move(Step::val);
+        Step::expr = nullptr;
+        Step::env = nullptr;
+        Step::val = nullptr;
+        Step::cont = nullptr;
+        try {
+            evaluation->done(result, error);
+        } catch (...) {
+            /* the callback has nobody to tell, but must not end the worker */
+        }
+        return;
+    }
+
+    evaluation->mode = Step::mode;
+    evaluation->expr = std::move(Step::expr);
+    evaluation->env = std::move(Step::env);
+    evaluation->val = std::move(Step::val);
+    evaluation->cont = std::move(Step::cont);
+    preemptionCount++;
+    enqueue(index, std::move(evaluation));
+}
+
+TEST_CASE("step scheduler") {
+    std::string count = "_let count = _fun(count) _fun(n)\n"
+                        "_if n == 0 _then 0 _else 1 + count(count)(n + -1)\n"
+                        "_in count(count)(";
+    std::mutex lock;
+    std::vector<std::string> results(1000);
+    std::vector<int> finishOrder;
+    {
+        StepScheduler scheduler(2, 100);
+        for (int i = 0; i < 1000; i++) {
+            /* every 100th program is a thousand times more expensive */
+            int n = i % 100 == 0 ? 50000 : 50;
+            std::string source = i == 501 ? "1 + _true" : count + std::to_string(n) + ")";
+            scheduler.submit(parseSource(source), Environment::empty(),
+                             [&lock, &results, &finishOrder, i](PTR(Value) value, const std::string &error) {
+                                 std::lock_guard<std::mutex> guard(lock);
+                                 results[i] = value == nullptr ? "error: " + error : value->toString();
+                                 finishOrder.push_back(i);
+                             });
+        }
+    }
+    for (int i = 0; i < 1000; i++) {
+        if (i == 501)
+            CHECK(results[i] == "error: not a number");
+        else
+            CHECK(results[i] == std::to_string(i % 100 == 0 ? 50000 : 50));
+    }
+    /* the ten expensive programs finish last */
+    for (int i = 990; i < 1000; i++)
+        CHECK(finishOrder[i] % 100 == 0);
+    CHECK(Step::interpBySteps(parseSource(count + "10)"))->toString() == "10");
+}
+
+TEST_CASE("step scheduler survives throwing callbacks") {
+    std::mutex lock;
+    std::vector<std::string> results(20);
+    {
+        StepScheduler scheduler(1, 10);
+        for (int i = 0; i < 20; i++) {
+            scheduler.submit(parseSource(i == 7 ? "1 + _true" : "1 + 2"), Environment::empty(),
+                             [&lock, &results, i](PTR(Value) value, const std::string &error) {
+                                 {
+                                     std::lock_guard<std::mutex> guard(lock);
+                                     results[i] = value == nullptr ? "error: " + error : value->toString();
+                                 }
+                                 if (i % 2 == 0)
+                                     throw std::bad_alloc();
+                                 if (i == 9)
+                                     throw 9;
+                             });
+        }
+    }
+    for (int i = 0; i < 20; i++)
+        CHECK(results[i] == (i == 7 ? "error: not a number" : "3"));
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "pointer.h"
+#include "step.h"
+
+class Expression;
+
+class Environment;
+
+class Value;
+
+class Continuation;
+
+class Budget;
+
+/**
+ * Runs many step-mode evaluations at once on a few worker threads
+ * (M:N green threads). A worker takes `stepsPerSlice` steps of an
+ * evaluation, then saves its `Step` registers and puts it at the back
+ * of its run queue, so cheap programs finish promptly even while
+ * expensive ones are running. A worker whose queue is empty steals an
+ * evaluation from another worker's queue.
+ */
+class StepScheduler {
+public:
+    /**
+     * Called once per evaluation, on a worker thread, with the result
+     * or, if evaluation failed, a null value and the error message.
+     */
+    typedef std::function<void(PTR(Value) value, const std::string &error)> callbackT;
+
+    /**
+     * Starts `workers` threads (at least one).
+     */
+    explicit StepScheduler(int workers, long stepsPerSlice = 1000);
+
+    /**
+     * Finishes every evaluation, then joins the workers.
+     */
+    ~StepScheduler();
+
+    /**
+     * Does what the destructor does, so an owner can wait for every
+     * callback before tearing down state they use. Later calls, and
+     * the destructor, then do nothing.
+     */
+    void shutdown();
+
+    /**
+     * Starts interpreting `e` by steps in `env`; `done` gets the outcome.
+     * Every slice is charged to `budget` unless it is null.
+     */
+    void submit(PTR(Expression) e, PTR(Environment) env, callbackT done, PTR(Budget) budget = nullptr);
+
+    /**
+     * @return how many times an evaluation has been paused for another.
+     */
+    long preemptions();
+
+private:
+    /* a paused evaluation: its saved registers and where its outcome goes */
+    class Evaluation {
+    public:
+        PTR(Expression) program; /* keeps the whole tree alive while it is stepped through */
+        Step::modeT mode;
+        PTR(Expression) expr;
+        PTR(Environment) env;
+        PTR(Value) val;
+        PTR(Continuation) cont;
+        callbackT done;
+        PTR(Budget) budget;
+    };
+
+    class Queue {
+    public:
+        std::mutex lock;
+        std::deque<std::unique_ptr<Evaluation>> ready;
+    };
+
+    long stepsPerSlice;
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<long> queued;
+    std::atomic<unsigned> nextQueue;
+    std::atomic<long> preemptionCount;
+
+    std::mutex sleepLock;
+    std::condition_variable wakeUp;
+    bool stopping;
+
+    void workerLoop(int index);
+
+    bool takeEvaluation(int index, std::unique_ptr<Evaluation> &evaluation);
+
+    void enqueue(int index, std::unique_ptr<Evaluation> evaluation);
+
+    void runSlice(int index, std::unique_ptr<Evaluation> evaluation);
+};
@@ -0,0 +1,505 @@
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "server.h"
+#include "program.h"
+#include "Environment.h"
+#include "value.h"
+#include "budget.h"
+#include "stats.h"
+#include "../catch/catch.hpp"
+
+class Server::Connection {
+public:
+    int fd;
+    std::string input;
+    std::string output;
+    bool readDone;
+    uint32_t watchedEvents;
+    long nextSequence; /* sequence number for the next request read */
+    long nextToSend;   /* sequence number of the next reply to write */
+    std::map<long, std::string> finished; /* guarded by Server::readyLock */
+    std::atomic<bool> closed; /* cancels the connection's unfinished evaluations */
+
+    explicit Connection(int fd);
+};
+
+Server::Connection::Connection(int fd) {
+    this->fd = fd;
+    this->readDone = false;
+    this->watchedEvents = EPOLLIN;
+    this->nextSequence = 0;
+    this->nextToSend = 0;
+    this->closed = false;
+}
+
+Server::Server(std::string socketPath, int jobs, size_t cacheCapacity)
+        : cache(cacheCapacity), steps(jobs), pool(jobs) {
+    this->socketPath = std::move(socketPath);
+    this->listenFd = -1;
+    this->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    this->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    this->stopping = false;
+    this->started = std::chrono::steady_clock::now();
+    this->requestCount = 0;
+    this->errorCount = 0;
+    this->evaluationCount = 0;
+    this->peakBytesTotal = 0;
+    this->peakBytesMax = 0;
+    for (std::atomic<long> &bucket : latencyBuckets)
+        bucket = 0;
+}
+
+Server::~Server() {
+    /*
+     * cancel what is still running and wait for it: pool tasks hand step
+     * requests to `steps`, and both write to `wakeFd` when they finish
+     */
+    for (auto &entry : connections)
+        entry.second->closed = true;
+    pool.shutdown();
+    steps.shutdown();
+
+    for (auto &entry : connections)
+        close(entry.first);
+    if (listenFd != -1) {
+        close(listenFd);
+        unlink(socketPath.c_str());
+    }
+    if (epollFd != -1)
+        close(epollFd);
+    if (wakeFd != -1)
+        close(wakeFd);
+}
+
+void Server::run() {
+    if (epollFd == -1 || wakeFd == -1)
+        throw std::runtime_error("epoll setup failed");
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path))
+        throw std::runtime_error("socket path too long: " + socketPath);
+    strcpy(address.sun_path, socketPath.c_str());
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd == -1)
+        throw std::runtime_error("socket failed");
+    unlink(socketPath.c_str());
+    if (bind(listenFd, (sockaddr *) &address, sizeof(address)) != 0 || listen(listenFd, SOMAXCONN) != 0)
+        throw std::runtime_error("cannot listen on " + socketPath);
+
+    for (int fd : {listenFd, wakeFd}) {
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+            throw std::runtime_error("epoll_ctl failed");
+    }
+
+    epoll_event events[64];
+    while (!stopping) {
+        int count = epoll_wait(epollFd, events, 64, -1);
+        if (count == -1 && errno != EINTR)
+            throw std::runtime_error("epoll_wait failed");
+
+        for (int i = 0; i < count; i++) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd) {
+                acceptConnections();
+            } else if (fd == wakeFd) {
+                collectReplies();
+            } else {
+                auto found = connections.find(fd);
+                if (found == connections.end())
+                    continue;
+                std::shared_ptr<Connection> connection = found->second;
+                if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                    /* both directions are gone, so no reply can be delivered */
+                    closeConnection(connection);
+                    continue;
+                }
+                if (events[i].events & EPOLLIN)
+                    readRequests(connection);
+                if (connections.count(fd) != 0 && (events[i].events & EPOLLOUT))
+                    writeReplies(connection);
+            }
+        }
+    }
+}
+
+void Server::stop() {
+    stopping = true;
+    uint64_t one = 1;
+    (void) write(wakeFd, &one, sizeof(one));
+}
+
+std::string Server::stats() {
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    long requests = requestCount;
+
+    long counts[32];
+    long total = 0;
+    for (int i = 0; i < 32; i++) {
+        counts[i] = latencyBuckets[i];
+        total += counts[i];
+    }
+
+    std::ostringstream out;
+    out << "requests " << requests << "\n";
+    out << "errors " << errorCount << "\n";
+    out << "uptime_s " << seconds << "\n";
+    out << "requests_per_s " << (seconds > 0 ? requests / seconds : 0) << "\n";
+    for (int percentile : {50, 90, 99}) {
+        /* report the upper bound of the bucket holding the percentile */
+        long seen = 0;
+        long bound = 0;
+        for (int i = 0; i < 32 && total > 0; i++) {
+            seen += counts[i];
+            if (seen * 100 >= total * percentile) {
+                bound = 1L << i;
+                break;
+            }
+        }
+        out << "latency_p" << percentile << "_us " << bound << "\n";
+    }
+    long evaluations = evaluationCount;
+    out << "peak_bytes_max " << peakBytesMax << "\n";
+    out << "peak_bytes_mean " << (evaluations > 0 ? peakBytesTotal / evaluations : 0) << "\n";
+    out << cache.stats();
+    if (Stats::enabled)
+        out << Stats::report();
+    return out.str();
+}
+
+void Server::acceptConnections() {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1)
+            return;
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            /* a connection the loop cannot watch would never be served */
+            close(fd);
+            continue;
+        }
+        connections[fd] = std::make_shared<Connection>(fd);
+    }
+}
+
+/**
+ * Reads whatever `connection` has sent and dispatches every complete
+ * request in it.
+ */
+void Server::readRequests(const std::shared_ptr<Connection> &connection) {
+    char buffer[65536];
+    while (!connection->readDone) {
+        ssize_t len = read(connection->fd, buffer, sizeof(buffer));
+        if (len > 0) {
+            connection->input.append(buffer, static_cast<size_t>(len));
+        } else if (len == -1 && errno == EINTR) {
+            continue;
+        } else if (len == -1 && errno == EAGAIN) {
+            break;
+        } else {
+            connection->readDone = true;
+        }
+    }
+
+    size_t start = 0;
+    while (true) {
+        size_t newline = connection->input.find('\n', start);
+        if (newline == std::string::npos && connection->input.size() - start <= maxHeaderBytes)
+            break;
+        std::string mode;
+        long length = -1;
+        if (newline != std::string::npos && newline - start <= maxHeaderBytes) {
+            std::istringstream header(connection->input.substr(start, newline - start));
+            std::string junk;
+            /* a failed read still stores 0 in `length` */
+            if (!(header >> mode >> length) || header >> junk || length > maxProgramBytes)
+                length = -1;
+        }
+        if (length < 0) {
+            /* without a length the stream cannot be resynchronized */
+            finish(connection, connection->nextSequence++, false, "bad request header",
+                   std::chrono::steady_clock::now());
+            connection->readDone = true;
+            start = connection->input.size();
+            break;
+        }
+        if (connection->input.size() - (newline + 1) < static_cast<size_t>(length))
+            break;
+        dispatch(connection, connection->nextSequence++, mode, connection->input.substr(newline + 1, length));
+        start = newline + 1 + length;
+    }
+    connection->input.erase(0, start);
+
+    writeReplies(connection);
+}
+
+void Server::dispatch(const std::shared_ptr<Connection> &connection, long sequence,
+                      const std::string &mode, std::string program) {
+    std::chrono::steady_clock::time_point received = std::chrono::steady_clock::now();
+
+    if (mode == "stats") {
+        finish(connection, sequence, true, stats(), received);
+        return;
+    }
+    Program::modeT programMode;
+    if (!Program::modeFromFlag(("-" + mode).c_str(), programMode)) {
+        finish(connection, sequence, false, "unknown mode " + mode, received);
+        return;
+    }
+
+    if (programMode == Program::StepMode) {
+        pool.submit([this, connection, sequence, program, received] {
+            PTR(Expression) e;
+            try {
+                e = cache.parsed(program);
+            } catch (std::exception &exn) {
+                finish(connection, sequence, false, exn.what(), received);
+                return;
+            }
+            PTR(Budget) budget = Program::budget(&connection->closed);
+            steps.submit(e, Environment::empty(),
+                         [this, connection, sequence, received, budget](PTR(Value) value, const std::string &error) {
+                             recordPeakBytes(budget->peakBytes());
+                             if (value == nullptr)
+                                 finish(connection, sequence, false, error, received);
+                             else
+                                 finish(connection, sequence, true, value->toString(), received);
+                         }, budget);
+        });
+        return;
+    }
+
+    pool.submit([this, connection, sequence, programMode, program, received] {
+        try {
+            long peakBytes = 0;
+            std::string result = cache.run(programMode, program, &connection->closed, &peakBytes);
+            recordPeakBytes(peakBytes);
+            finish(connection, sequence, true, result, received);
+        } catch (std::exception &exn) {
+            /* a bad_alloc fails this request, not the server */
+            finish(connection, sequence, false, exn.what(), received);
+        } catch (...) {
+            finish(connection, sequence, false, "unknown error", received);
+        }
+    });
+}
+
+void Server::recordPeakBytes(long bytes) {
+    evaluationCount++;
+    peakBytesTotal += bytes;
+    long largest = peakBytesMax;
+    while (bytes > largest && !peakBytesMax.compare_exchange_weak(largest, bytes)) {
+    }
+}
+
+/**
+ * Records the reply to request `sequence` of `connection` and wakes
+ * the event loop to send it. Called from the workers and the loop.
+ */
+void Server::finish(const std::shared_ptr<Connection> &connection, long sequence, bool ok,
+                    const std::string &reply, std::chrono::steady_clock::time_point received) {
+    long micros = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - received).count();
+    int bucket = 0;
+    while (bucket < 31 && (1L << bucket) <= micros)
+        bucket++;
+    latencyBuckets[bucket]++;
+    requestCount++;
+    if (!ok)
+        errorCount++;
+
+    std::string message = (ok ? "ok " : "error ") + std::to_string(reply.size()) + "\n" + reply;
+    {
+        std::lock_guard<std::mutex> guard(readyLock);
+        connection->finished[sequence] = std::move(message);
+        ready.push_back(connection);
+    }
+    uint64_t one = 1;
+    (void) write(wakeFd, &one, sizeof(one));
+}
+
+void Server::collectReplies() {
+    uint64_t count;
+    (void) read(wakeFd, &count, sizeof(count));
+
+    std::vector<std::shared_ptr<Connection>> readyNow;
+    {
+        std::lock_guard<std::mutex> guard(readyLock);
+        readyNow.swap(ready);
+    }
+    for (const std::shared_ptr<Connection> &connection : readyNow) {
+        if (connections.count(connection->fd) != 0 && connections[connection->fd] == connection)
+            writeReplies(connection);
+    }
+}
+
+/**
+ * Writes the replies of `connection` that are next in request order,
+ * and closes it once the client has stopped sending and everything
+ * has been answered.
+ */
+void Server::writeReplies(const std::shared_ptr<Connection> &connection) {
+    {
+        std::lock_guard<std::mutex> guard(readyLock);
+        auto next = connection->finished.find(connection->nextToSend);
+        while (next != connection->finished.end()) {
+            connection->output += next->second;
+            connection->finished.erase(next);
+            next = connection->finished.find(++connection->nextToSend);
+        }
+    }
+
+    while (!connection->output.empty()) {
+        ssize_t len = send(connection->fd, connection->output.data(), connection->output.size(), MSG_NOSIGNAL);
+        if (len > 0) {
+            connection->output.erase(0, static_cast<size_t>(len));
+        } else if (len == -1 && errno == EINTR) {
+            continue;
+        } else if (len == -1 && errno == EAGAIN) {
+            break;
+        } else {
+            closeConnection(connection);
+            return;
+        }
+    }
+
+    if (connection->readDone && connection->output.empty()
+        && connection->nextToSend == connection->nextSequence) {
+        closeConnection(connection);
+        return;
+    }
+    watch(connection);
+}
+
+/**
+ * Asks epoll for readability until the client stops sending, and for
+ * writability only while `connection` has unsent output.
+ */
+void Server::watch(const std::shared_ptr<Connection> &connection) {
+    uint32_t events = (connection->readDone ? 0 : (uint32_t) EPOLLIN)
+                      | (connection->output.empty() ? 0 : (uint32_t) EPOLLOUT);
+    if (events == connection->watchedEvents)
+        return;
+    epoll_event event = {};
+    event.events = events;
+    event.data.fd = connection->fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_MOD, connection->fd, &event) != 0) {
+        closeConnection(connection);
+        return;
+    }
+    connection->watchedEvents = events;
+}
+
+void Server::closeConnection(const std::shared_ptr<Connection> &connection) {
+    connection->closed = true;
+    /* every connection in `connections` was added, so only a bug makes this fail */
+    if (epoll_ctl(epollFd, EPOLL_CTL_DEL, connection->fd, nullptr) != 0)
+        throw std::runtime_error("epoll_ctl failed");
+    close(connection->fd);
+    connections.erase(connection->fd);
+}
+
+/* for tests: sends `requests` on one connection and reads `replies` replies */
+static std::vector<std::string> askServer(const std::string &socketPath, const std::string &requests, int replies) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socketPath.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    while (connect(fd, (sockaddr *) &address, sizeof(address)) != 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    (void) write(fd, requests.data(), requests.size());
+    shutdown(fd, SHUT_WR);
+
+    std::string received;
+    char buffer[4096];
+    ssize_t len;
+    while ((len = read(fd, buffer, sizeof(buffer))) > 0)
+        received.append(buffer, static_cast<size_t>(len));
+    close(fd);
+
+    std::vector<std::string> result;
+    size_t start = 0;
+    while (static_cast<int>(result.size()) < replies) {
+        size_t newline = received.find('\n', start);
+        if (newline == std::string::npos)
+            break;
+        std::istringstream header(received.substr(start, newline - start));
+        std::string status;
+        size_t length;
+        header >> status >> length;
+        result.push_back(status + ":" + received.substr(newline + 1, length));
+        start = newline + 1 + length;
+    }
+    return result;
+}
+
+TEST_CASE("server answers pipelined requests in order") {
+    std::string socketPath = "/tmp/msdscript-test-" + std::to_string(getpid()) + ".sock";
+    Server server(socketPath, 2, 16);
+    std::thread loop([&server] { server.run(); });
+
+    std::string countdown = "_let countdown = _fun(countdown) _fun(n)\n"
+                            "_if n == 0 _then 0 _else countdown(countdown)(n + -1)\n"
+                            "_in countdown(countdown)(20000)";
+    std::string requests = "step " + std::to_string(countdown.size()) + "\n" + countdown
+                           + "interp 5\n1 + 2"
+                           + "opt 9\nx + 1 + 1"
+                           + "interp 5\n1 + 2"
+                           + "interp 1\ny"
+                           + "bogus 1\n1"
+                           + "stats 0\n";
+    std::vector<std::string> replies = askServer(socketPath, requests, 7);
+
+    server.stop();
+    loop.join();
+
+    REQUIRE(replies.size() == 7);
+    CHECK(replies[0] == "ok:0");
+    CHECK(replies[1] == "ok:3");
+    CHECK(replies[2] == "ok:(x + 2)");
+    CHECK(replies[3] == "ok:3");
+    CHECK(replies[4] == "error:free variable: y");
+    CHECK(replies[5] == "error:unknown mode bogus");
+    CHECK(replies[6].find("ok:requests ") == 0);
+    CHECK(replies[6].find("latency_p99_us ") != std::string::npos);
+    CHECK(replies[6].find("cache_hits ") != std::string::npos);
+}
+
+TEST_CASE("server rejects bad request headers") {
+    std::string socketPath = "/tmp/msdscript-test-" + std::to_string(getpid()) + ".sock";
+    Server server(socketPath, 1, 16);
+    std::thread loop([&server] { server.run(); });
+
+    std::vector<std::string> notNumeric = askServer(socketPath, "interp 5\n1 + 2interp abc\n1 + 2", 2);
+    std::vector<std::string> junk = askServer(socketPath, "interp 5 6\n1 + 2", 1);
+    std::vector<std::string> negative = askServer(socketPath, "interp -1\n", 1);
+    std::vector<std::string> tooLong = askServer(socketPath, "interp 99999999999\n1 + 2", 1);
+    std::vector<std::string> overflow = askServer(socketPath, "interp 99999999999999999999999\n", 1);
+    std::vector<std::string> noNewline = askServer(socketPath, "interp " + std::string(100, '1'), 1);
+
+    server.stop();
+    loop.join();
+
+    REQUIRE(notNumeric.size() == 2);
+    CHECK(notNumeric[0] == "ok:3");
+    CHECK(notNumeric[1] == "error:bad request header");
+    for (const std::vector<std::string> &replies : {junk, negative, tooLong, overflow, noNewline})
+        CHECK(replies == std::vector<std::string>({"error:bad request header"}));
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "pool.h"
+#include "cache.h"
+#include "scheduler.h"
+
+/**
+ * A long-running evaluator that listens on a Unix domain socket, so
+ * callers pay for process start-up once instead of once per program.
+ *
+ * Every request is a header line `mode length` followed by exactly
+ * `length` bytes of program text, where `mode` is `interp`, `step`,
+ * `opt` or `stats` (which takes an empty program). Every reply is a
+ * header line `ok length` or `error length` followed by `length` bytes
+ * of result or error message. A client may send many requests without
+ * waiting; replies on one connection always come back in request order.
+ * A malformed header, or one asking for more than `maxProgramBytes`,
+ * gets a `bad request header` error and ends the connection.
+ *
+ * One thread runs an epoll event loop that reads requests and writes
+ * replies; programs are evaluated on a `WorkStealingPool`, with their
+ * parsed and optimized forms kept in a `ProgramCache`. `step` requests
+ * are time-sliced on a `StepScheduler` instead, so a few long-running
+ * programs cannot hold up the quick ones behind them.
+ */
+class Server {
+public:
+    static const long maxProgramBytes = 16L << 20;
+    static const size_t maxHeaderBytes = 64; /* without its newline */
+
+    Server(std::string socketPath, int jobs, size_t cacheCapacity);
+
+    ~Server();
+
+    /**
+     * Serves requests until `stop` is called.
+     * @throws Throws `runtime_error` if the socket cannot be set up.
+     */
+    void run();
+
+    /**
+     * Makes `run` return; may be called from any thread.
+     */
+    void stop();
+
+    /**
+     * @return request count, error count, throughput, latency
+     * percentiles, largest and mean peak heap bytes per evaluation and
+     * cache counters since the server started, one `name value` per line,
+     * followed by the `Stats` report when it is compiled in.
+     */
+    std::string stats();
+
+private:
+    class Connection;
+
+    std::string socketPath;
+    ProgramCache cache;
+    int listenFd;
+    int epollFd;
+    int wakeFd;
+    std::atomic<bool> stopping;
+
+    std::map<int, std::shared_ptr<Connection>> connections;
+
+    /* connections with finished replies, handed from workers to the event loop */
+    std::mutex readyLock;
+    std::vector<std::shared_ptr<Connection>> ready;
+
+    std::chrono::steady_clock::time_point started;
+    std::atomic<long> requestCount;
+    std::atomic<long> errorCount;
+    std::atomic<long> latencyBuckets[32]; /* bucket i counts latencies below 2^i microseconds */
+    std::atomic<long> evaluationCount;
+    std::atomic<long> peakBytesTotal; /* sum over evaluations of each one's peak heap bytes */
+    std::atomic<long> peakBytesMax;
+
+    /* shut down first thing in ~Server, and declared last as well, so no work outlives what it uses */
+    StepScheduler steps;
+    WorkStealingPool pool;
+
+    void acceptConnections();
+
+    void readRequests(const std::shared_ptr<Connection> &connection);
+
+    void dispatch(const std::shared_ptr<Connection> &connection, long sequence,
+                  const std::string &mode, std::string program);
+
+    void finish(const std::shared_ptr<Connection> &connection, long sequence, bool ok,
+                const std::string &reply, std::chrono::steady_clock::time_point received);
+
+    void recordPeakBytes(long bytes);
+
+    void collectReplies();
+
+    void writeReplies(const std::shared_ptr<Connection> &connection);
+
+    void watch(const std::shared_ptr<Connection> &connection);
+
+    void closeConnection(const std::shared_ptr<Connection> &connection);
+};
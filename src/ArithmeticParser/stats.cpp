@@ -0,0 +1,133 @@
+#include <mutex>
+#include <sstream>
+#include <vector>
+#include "stats.h"
+#include "parse.h"
+#include "step.h"
+#include "Environment.h"
+#include "expression.hpp"
+#include "../catch/catch.hpp"
+
+#ifdef MSD_STATS
+const bool Stats::enabled = true;
+#else
+const bool Stats::enabled = false;
+#endif
+
+static const char *expressionNames[Stats::expressionKinds] = {
+        "NumberExpression", "AddExpression", "MultiplyExpression", "VariableExpression", "LetExpression",
+        "BooleanExpression", "IfExpression", "EqualsExpression", "FunctionExpression", "CallExpression"
+};
+
+static const char *continuationNames[Stats::continuationKinds] = {
+        "RightThenAddContinuation", "AddContinuation", "RightThenMultiplyContinuation", "MultiplyContinuation",
+        "RightThenCompContinuation", "CompContinuation", "IfBranchCont", "LetBodyCont", "ArgThenCallCont",
+        "CallCont"
+};
+
+/* every thread's counters; never freed, so counts outlive their threads */
+static std::mutex registryLock;
+static std::vector<Stats::Counters *> registry;
+
+Stats::Counters::Counters() {
+    clear();
+}
+
+void Stats::Counters::clear() {
+    for (std::atomic<long> &count : evaluations)
+        count = 0;
+    lookups = 0;
+    linksWalked = 0;
+    calls = 0;
+    steps = 0;
+    for (std::atomic<long> &count : continuations)
+        count = 0;
+    liveContinuations = 0;
+    peakContinuations = 0;
+}
+
+Stats::Counters *Stats::registerThread() {
+    Counters *counters = new Counters();
+    std::lock_guard<std::mutex> guard(registryLock);
+    registry.push_back(counters);
+    return counters;
+}
+
+std::string Stats::report() {
+    if (!enabled)
+        return "stats not compiled in; build with -DMSD_STATS\n";
+
+    Counters total;
+    {
+        std::lock_guard<std::mutex> guard(registryLock);
+        for (Counters *counters : registry) {
+            for (int kind = 0; kind < expressionKinds; kind++)
+                total.evaluations[kind] += counters->evaluations[kind];
+            total.lookups += counters->lookups;
+            total.linksWalked += counters->linksWalked;
+            total.calls += counters->calls;
+            total.steps += counters->steps;
+            for (int kind = 0; kind < continuationKinds; kind++)
+                total.continuations[kind] += counters->continuations[kind];
+            if (counters->peakContinuations > total.peakContinuations)
+                total.peakContinuations = counters->peakContinuations.load();
+        }
+    }
+
+    std::ostringstream out;
+    for (int kind = 0; kind < expressionKinds; kind++)
+        out << "evaluated_" << expressionNames[kind] << " " << total.evaluations[kind] << "\n";
+    out << "env_lookups " << total.lookups << "\n";
+    out << "env_mean_depth " << (total.lookups == 0 ? 0 : (double) total.linksWalked / total.lookups) << "\n";
+    out << "function_calls " << total.calls << "\n";
+    out << "steps " << total.steps << "\n";
+    for (int kind = 0; kind < continuationKinds; kind++)
+        out << "made_" << continuationNames[kind] << " " << total.continuations[kind] << "\n";
+    out << "peak_continuations " << total.peakContinuations << "\n";
+    return out.str();
+}
+
+void Stats::reset() {
+    std::lock_guard<std::mutex> guard(registryLock);
+    for (Counters *counters : registry)
+        counters->clear();
+}
+
+[[maybe_unused]] static long reported(const std::string &report, const std::string &name) {
+    std::istringstream in(report);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, name.size() + 1, name + " ") == 0)
+            return std::stol(line.substr(name.size() + 1));
+    }
+    return -1;
+}
+
+TEST_CASE("interpreter stats") {
+    if (!Stats::enabled) {
+        CHECK(Stats::report() == "stats not compiled in; build with -DMSD_STATS\n");
+        return;
+    }
+
+    std::istringstream in("_let f = _fun (x) x + 1 _in f(2) * f(3)");
+    PTR(Expression) program = parse(in);
+
+    Stats::reset();
+    CHECK(program->interpret(Environment::empty())->toString() == "12");
+    std::string report = Stats::report();
+    CHECK(reported(report, "evaluated_CallExpression") == 2);
+    CHECK(reported(report, "evaluated_AddExpression") == 2);
+    CHECK(reported(report, "function_calls") == 2);
+    CHECK(reported(report, "env_lookups") == 4);
+    CHECK(reported(report, "steps") == 0);
+
+    Stats::reset();
+    CHECK(Step::interpBySteps(program, Environment::empty())->toString() == "12");
+    report = Stats::report();
+    CHECK(reported(report, "evaluated_CallExpression") == 2);
+    CHECK(reported(report, "function_calls") == 2);
+    CHECK(reported(report, "made_CallCont") == 2);
+    CHECK(reported(report, "made_RightThenMultiplyContinuation") == 1);
+    CHECK(reported(report, "steps") > 0);
+    CHECK(reported(report, "peak_continuations") >= 3);
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+/**
+ * Counts of what the interpreters do: expressions evaluated by kind,
+ * variable lookups and the environment links they walk, function
+ * calls, steps taken, continuations made by kind and the most
+ * continuations live at once on a thread.
+ *
+ * Counting is compiled in only when `MSD_STATS` is defined, as the
+ * `statsExec` target does to test it. Otherwise the `STAT_...` macros
+ * expand to nothing, `Stats::enabled` is false and `report` says so.
+ * When compiled in, each thread counts into its own `Counters`, so a
+ * count is a thread-local load and store with no locked instruction;
+ * `report` adds up every thread's counters.
+ */
+class Stats {
+public:
+    typedef enum {
+        NumberKind,
+        AddKind,
+        MultiplyKind,
+        VariableKind,
+        LetKind,
+        BooleanKind,
+        IfKind,
+        EqualsKind,
+        FunctionKind,
+        CallKind,
+        expressionKinds
+    } expressionKindT;
+
+    typedef enum {
+        RightThenAddKind,
+        AddContKind,
+        RightThenMultiplyKind,
+        MultiplyContKind,
+        RightThenCompKind,
+        CompContKind,
+        IfBranchKind,
+        LetBodyKind,
+        ArgThenCallKind,
+        CallContKind,
+        continuationKinds
+    } continuationKindT;
+
+    /**
+     * One thread's counts. Only the owning thread writes them; they are
+     * atomics so `report` may read them while the thread runs.
+     */
+    class Counters {
+    public:
+        std::atomic<long> evaluations[expressionKinds];
+        std::atomic<long> lookups;
+        std::atomic<long> linksWalked;
+        std::atomic<long> calls;
+        std::atomic<long> steps;
+        std::atomic<long> continuations[continuationKinds];
+        std::atomic<long> liveContinuations;
+        std::atomic<long> peakContinuations;
+
+        Counters();
+
+        void clear();
+    };
+
+    static const bool enabled;
+
+    /**
+     * @return this thread's counters, registered on first use.
+     */
+    static Counters &local() {
+        static thread_local Counters *counters = nullptr;
+        if (counters == nullptr)
+            counters = registerThread();
+        return *counters;
+    }
+
+    static void bump(std::atomic<long> &counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    static void continuationMade(continuationKindT kind) {
+        Counters &counters = local();
+        bump(counters.continuations[kind]);
+        long live = counters.liveContinuations.load(std::memory_order_relaxed) + 1;
+        counters.liveContinuations.store(live, std::memory_order_relaxed);
+        if (live > counters.peakContinuations.load(std::memory_order_relaxed))
+            counters.peakContinuations.store(live, std::memory_order_relaxed);
+    }
+
+    static void continuationFreed() {
+        Counters &counters = local();
+        counters.liveContinuations.store(counters.liveContinuations.load(std::memory_order_relaxed) - 1,
+                                         std::memory_order_relaxed);
+    }
+
+    /**
+     * @return the counts summed over all threads so far, one
+     * `name value` per line, or a note that counting is not compiled in.
+     */
+    static std::string report();
+
+    /**
+     * Zeroes every thread's counts. Counts made by threads running at
+     * the same time may be lost.
+     */
+    static void reset();
+
+private:
+    static Counters *registerThread();
+};
+
+#ifdef MSD_STATS
+# define STAT_EVALUATION(kind) Stats::bump(Stats::local().evaluations[Stats::kind])
+# define STAT_COUNT(counter) Stats::bump(Stats::local().counter)
+# define STAT_CONTINUATION_MADE(kind) Stats::continuationMade(Stats::kind)
+# define STAT_CONTINUATION_FREED() Stats::continuationFreed()
+#else
+# define STAT_EVALUATION(kind) ((void) 0)
+# define STAT_COUNT(counter) ((void) 0)
+# define STAT_CONTINUATION_MADE(kind) ((void) 0)
+# define STAT_CONTINUATION_FREED() ((void) 0)
+#endif
@@ -2,30 +2,51 @@
 
 #include "Environment.h"
 #include "continuation.h"
+#include "budget.h"
+#include "stats.h"
+#include "profile.h"
 
-Step::modeT Step::mode;
-PTR(Expression) Step::expr;
-PTR(Environment) Step::env;
-PTR(Value) Step::val;
-PTR(Continuation) Step::cont;
+thread_local Step::modeT Step::mode;
+thread_local PTR(Expression) Step::expr;
+thread_local PTR(Environment) Step::env;
+thread_local PTR(Value) Step::val;
+thread_local PTR(Continuation) Step::cont;
 
 PTR(Continuation) Continuation::done;
 
 PTR(Value) Step::interpBySteps(PTR(Expression) e) {
+    return interpBySteps(e, NEW(EmptyEnv)());
+}
+
+PTR(Value) Step::interpBySteps(PTR(Expression) e, PTR(Environment) env) {
+    start(e, env);
+    run(-1);
+    return Step::val;
+}
+
+void Step::start(PTR(Expression) e, PTR(Environment) env) {
     Step::mode = Step::InterpMode;
     Step::expr = e; //this needs to be e and not be std::move(e)
-    Step::env = NEW(EmptyEnv)();
+    Step::env = env;
     Step::val = nullptr;
     Step::cont = Continuation::done;
+}
 
-    while (true) {
-        if (Step::mode == Step::InterpMode)
-            Step::expr->stepInterpret();
-        else {
+bool Step::run(long maxSteps) {
+    Profiler::Frame frame;
+    for (long taken = 0; maxSteps < 0 || taken < maxSteps; taken++) {
+        Budget::charge();
+        STAT_COUNT(steps);
+        if (Step::mode == Step::InterpMode) {
+            /* held here, since stepping may drop the register's last reference to it */
+            PTR(Expression) current = Step::expr;
+            current->stepInterpret();
+        } else {
             if (Step::cont == Continuation::done)
-                return Step::val;
+                return true;
             else
                 Step::cont->stepContinue();
         }
     }
+    return Step::mode == Step::ContinueMode && Step::cont == Continuation::done;
 }
\ No newline at end of file
@@ -13,6 +13,10 @@ class EmptyEnv;
 
 class Value;
 
+/**
+ * The registers of the step interpreter. Each thread has its own
+ * set, so separate threads can interpret by steps at the same time.
+ */
 class Step {
 public:
     typedef enum {
@@ -20,18 +24,37 @@ public:
         ContinueMode
     } modeT;
 
-    static modeT mode; /* chooses the mode */
+    static thread_local modeT mode; /* chooses the mode */
 
-    static PTR(Expression) expr; /* for interp_mode */
+    static thread_local PTR(Expression) expr; /* for interp_mode */
 
-    static PTR(Environment) env; /* for interp_mode */
+    static thread_local PTR(Environment) env; /* for interp_mode */
 
-    static PTR(Value) val; /* for ContinueMode */
+    static thread_local PTR(Value) val; /* for ContinueMode */
 
-    static PTR(Continuation) cont; /* all modes */
+    static thread_local PTR(Continuation) cont; /* all modes */
 
     PTR(Value)
 
     static interpBySteps(PTR(Expression) e);
+
+    /**
+     * Like `interpBySteps(e)`, but with `env` giving the values of
+     * `e`'s free variables.
+     */
+    static PTR(Value) interpBySteps(PTR(Expression) e, PTR(Environment) env);
+
+    /**
+     * Sets the registers to begin interpreting `e` in `env`.
+     */
+    static void start(PTR(Expression) e, PTR(Environment) env);
+
+    /**
+     * Takes at most `maxSteps` steps (any number if negative) from the
+     * current registers, so an evaluation can be paused by saving the
+     * registers and resumed by restoring them.
+     * @return whether evaluation finished, with the result in `val`.
+     */
+    static bool run(long maxSteps);
 };
 
@@ -0,0 +1,193 @@
+#include <cstdio>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "trace.h"
+#include "parse.h"
+#include "program.h"
+#include "../catch/catch.hpp"
+
+std::atomic<bool> Tracer::active(false);
+std::atomic<bool> Tracer::tracingCalls(false);
+std::atomic<long> Tracer::callEvery(0);
+std::atomic<long> Tracer::minNanos(0);
+thread_local long Tracer::untilCall = 0;
+
+/**
+ * One recorded event, from trace `epoch`. Its fields are atomics
+ * written and read with relaxed ordering, with `sequence` as a
+ * per-slot seqlock around them: 0 while the owner is writing,
+ * otherwise one more than the number of the event the slot holds.
+ */
+class TraceEvent {
+public:
+    std::atomic<long> sequence;
+    std::atomic<long> epoch;
+    std::atomic<const char *> name;
+    std::atomic<char> phase;
+    std::atomic<long> begin;
+    std::atomic<long> end;
+};
+
+/**
+ * One thread's ring of events. `written` counts every event the thread
+ * has ever recorded, and is never reset, so event `i` is in slot
+ * `i % bufferEvents` and the newest `bufferEvents` survive. Only the
+ * owner thread writes it or the events.
+ */
+class TraceBuffer {
+public:
+    TraceEvent events[Tracer::bufferEvents];
+    std::atomic<long> written;
+    int thread;
+};
+
+/* every thread's buffer; never freed, so a trace can outlive its threads */
+static std::mutex buffersLock;
+static std::vector<TraceBuffer *> buffers;
+static long startedAt = 0;
+
+/* the current trace; `start` and `stop` each begin a new one, retiring the last */
+static std::atomic<long> currentEpoch(1);
+
+void Tracer::start(long callEvery, std::chrono::microseconds minDuration) {
+    currentEpoch++;
+    Tracer::callEvery = callEvery;
+    minNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(minDuration).count();
+    startedAt = now();
+    tracingCalls = callEvery > 0;
+    active = true;
+}
+
+std::string Tracer::stop() {
+    active = false;
+    tracingCalls = false;
+    /* events recorded from here on belong to the next trace */
+    long epoch = currentEpoch++;
+
+    std::ostringstream out;
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    char number[64];
+    std::lock_guard<std::mutex> guard(buffersLock);
+    for (TraceBuffer *buffer : buffers) {
+        long written = buffer->written.load(std::memory_order_acquire);
+        long oldest = written > bufferEvents ? written - bufferEvents : 0;
+        for (long i = oldest; i < written; i++) {
+            TraceEvent &slot = buffer->events[i % bufferEvents];
+            if (slot.sequence.load(std::memory_order_acquire) != i + 1)
+                continue;
+            long slotEpoch = slot.epoch.load(std::memory_order_relaxed);
+            const char *name = slot.name.load(std::memory_order_relaxed);
+            char phase = slot.phase.load(std::memory_order_relaxed);
+            long begin = slot.begin.load(std::memory_order_relaxed);
+            long end = slot.end.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != i + 1)
+                continue; /* overwritten while it was being copied */
+            if (slotEpoch != epoch)
+                continue;
+
+            out << (first ? "\n" : ",\n");
+            first = false;
+            snprintf(number, sizeof(number), "%.3f", (begin - startedAt) / 1000.0);
+            out << "{\"name\":\"" << name << "\",\"cat\":\"msdscript\",\"ph\":\"" << phase
+                << "\",\"ts\":" << number;
+            if (phase == 'X') {
+                snprintf(number, sizeof(number), "%.3f", (end - begin) / 1000.0);
+                out << ",\"dur\":" << number;
+            } else {
+                out << ",\"s\":\"t\"";
+            }
+            out << ",\"pid\":1,\"tid\":" << buffer->thread << "}";
+        }
+    }
+    out << "\n]}\n";
+    return out.str();
+}
+
+void Tracer::record(const char *name, char phase, long begin, long end) {
+    if (phase == 'X' && end - begin < minNanos.load(std::memory_order_relaxed))
+        return;
+
+    static thread_local TraceBuffer *buffer = nullptr;
+    if (buffer == nullptr) {
+        buffer = new TraceBuffer();
+        std::lock_guard<std::mutex> guard(buffersLock);
+        buffer->thread = (int) buffers.size() + 1;
+        buffers.push_back(buffer);
+    }
+
+    long next = buffer->written.load(std::memory_order_relaxed);
+    TraceEvent &slot = buffer->events[next % bufferEvents];
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.epoch.store(currentEpoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.phase.store(phase, std::memory_order_relaxed);
+    slot.begin.store(begin, std::memory_order_relaxed);
+    slot.end.store(end, std::memory_order_relaxed);
+    slot.sequence.store(next + 1, std::memory_order_release);
+    buffer->written.store(next + 1, std::memory_order_release);
+}
+
+[[maybe_unused]] static long occurrences(const std::string &text, const std::string &part) {
+    long count = 0;
+    for (size_t at = text.find(part); at != std::string::npos; at = text.find(part, at + 1))
+        count++;
+    return count;
+}
+
+TEST_CASE("trace events") {
+    std::string program = "_let f = _fun (x) x + 1 _in f(1) + f(2) + f(3) + f(4)";
+
+    Tracer::start();
+    CHECK(Program::run(Program::InterpMode, program, nullptr) == "14");
+    std::string trace = Tracer::stop();
+    CHECK(trace.compare(0, 16, "{\"traceEvents\":[") == 0);
+    CHECK(occurrences(trace, "\"name\":\"parse\"") == 1);
+    CHECK(occurrences(trace, "\"name\":\"evaluate interp\"") == 1);
+    CHECK(occurrences(trace, "\"name\":\"call\"") == 0);
+
+    Tracer::start(2);
+    CHECK(Program::run(Program::InterpMode, program, nullptr) == "14");
+    CHECK(Program::run(Program::StepMode, program, nullptr) == "14");
+    CHECK(Program::run(Program::OptimizeMode, "1 + 2", nullptr) == "3");
+    trace = Tracer::stop();
+    CHECK(occurrences(trace, "\"name\":\"parse\"") == 3);
+    CHECK(occurrences(trace, "\"name\":\"call\"") == 2);
+    CHECK(occurrences(trace, "\"name\":\"step call\"") == 2);
+    CHECK(occurrences(trace, "\"name\":\"optimize\"") == 1);
+    CHECK(occurrences(trace, "\"ph\":\"X\"") == occurrences(trace, "\"dur\":"));
+
+    Tracer::start(1, std::chrono::microseconds(60 * 1000 * 1000));
+    CHECK(Program::run(Program::InterpMode, program, nullptr) == "14");
+    trace = Tracer::stop();
+    CHECK(occurrences(trace, "\"ph\":\"X\"") == 0);
+
+    CHECK(Program::run(Program::InterpMode, program, nullptr) == "14");
+    CHECK(Tracer::stop() == "{\"traceEvents\":[\n]}\n");
+}
+
+TEST_CASE("trace while other threads record") {
+    std::atomic<bool> done(false);
+    std::vector<std::thread> threads;
+    Tracer::start();
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([&done] {
+            while (!done)
+                Tracer::instant("tick");
+        });
+    }
+    for (int i = 0; i < 50; i++) {
+        std::string trace = Tracer::stop();
+        CHECK(trace.compare(0, 16, "{\"traceEvents\":[") == 0);
+        CHECK(occurrences(trace, "{\"name\":\"tick\"") == occurrences(trace, "\"ph\":\"i\""));
+        Tracer::start();
+    }
+    done = true;
+    for (std::thread &thread : threads)
+        thread.join();
+    Tracer::stop();
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+/**
+ * An opt-in tracer that records when each parse, optimization and
+ * top-level evaluation began and ended, and optionally every function
+ * call, and writes them as Chrome trace-event JSON for Perfetto or
+ * `chrome://tracing`.
+ *
+ * Each thread records into its own ring buffer of `bufferEvents`
+ * events, which only that thread writes, so recording takes no lock;
+ * once a buffer is full its oldest events are overwritten. Every slot
+ * carries the sequence number of the event in it, so `stop` can read
+ * buffers that are still being written and skip any slot it catches
+ * mid-write, and each trace is an epoch, so one trace's events are
+ * never mixed into the next without any buffer being reset under its
+ * owner. Calls are
+ * far more frequent than anything else, so they are only traced when
+ * asked for, and then only one call in `callEvery` per thread. Spans
+ * shorter than `minDuration` are dropped as they end.
+ */
+class Tracer {
+public:
+    static const long bufferEvents = 1L << 14;
+
+    /**
+     * Starts recording.
+     * @param callEvery trace one function call in this many on each
+     * thread, or none if zero or less.
+     * @param minDuration drop spans shorter than this.
+     */
+    static void start(long callEvery = 0, std::chrono::microseconds minDuration = std::chrono::microseconds(0));
+
+    /**
+     * Stops recording and discards the recorded events.
+     * @return the recorded events as a trace-event JSON object.
+     */
+    static std::string stop();
+
+    /**
+     * Records `name` as a span from construction to destruction, if
+     * tracing and `name` is not null.
+     */
+    class Span {
+    public:
+        explicit Span(const char *name) : name(name != nullptr && active.load(std::memory_order_relaxed) ? name : nullptr) {
+            if (this->name != nullptr)
+                begin = now();
+        }
+
+        ~Span() {
+            if (name != nullptr)
+                record(name, 'X', begin, now());
+        }
+
+        Span(const Span &) = delete;
+
+        Span &operator=(const Span &) = delete;
+
+    private:
+        const char *name;
+        long begin = 0;
+    };
+
+    /**
+     * @return whether to trace the function call about to be made.
+     */
+    static bool sampleCall() {
+        if (!tracingCalls.load(std::memory_order_relaxed) || --untilCall > 0)
+            return false;
+        untilCall = callEvery.load(std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * Records `name` as a moment, if tracing.
+     */
+    static void instant(const char *name) {
+        if (active.load(std::memory_order_relaxed)) {
+            long at = now();
+            record(name, 'i', at, at);
+        }
+    }
+
+private:
+    static std::atomic<bool> active;
+    static std::atomic<bool> tracingCalls;
+    static std::atomic<long> callEvery;
+    static std::atomic<long> minNanos;
+    static thread_local long untilCall;
+
+    static long now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static void record(const char *name, char phase, long begin, long end);
+};
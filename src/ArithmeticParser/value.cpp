@@ -6,6 +6,8 @@
 #include "Environment.h"
 #include "expression.hpp"
 #include "continuation.h"
+#include "stats.h"
+#include "trace.h"
 
 NumberValue::NumberValue(int rep) {
     this->primitiveValue = rep;
@@ -111,6 +113,8 @@ PTR(Expression)FunctionValue::toExpression() {
 }
 
 PTR(Value)FunctionValue::call(PTR(Value) argument) {
+    STAT_COUNT(calls);
+    Tracer::Span span(Tracer::sampleCall() ? "call" : nullptr);
     return this->body->interpret(NEW(ExtendedEnv)(this->formalArg, argument, this->env));
 }
 
@@ -123,6 +127,7 @@ std::string FunctionValue::toString() {
 }
 
 void FunctionValue::callStep(PTR(Value) actualArgVal, PTR(Continuation) rest) {
+    STAT_COUNT(calls);
     Step::mode = Step::InterpMode;
     Step::expr = body;
     Step::env = NEW(ExtendedEnv)(formalArg, actualArgVal, env);
@@ -0,0 +1,358 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "workloads.hpp"
+#include "generator.hpp"
+#include "scaling.hpp"
+#include "regression.hpp"
+#include "startup.hpp"
+#include "../ArithmeticParser/parse.h"
+#include "../ArithmeticParser/expression.hpp"
+#include "../ArithmeticParser/Environment.h"
+#include "../ArithmeticParser/step.h"
+#include "../ArithmeticParser/perf.h"
+
+/**
+ * benchmark [-quick] [-samples n] [-only workload] [-compare baseline.json] [-threshold percent] [-alpha p]
+ *           [-allow-missing]
+ * benchmark -compare-files baseline.json current.json [-threshold percent] [-alpha p] [-allow-missing]
+ * benchmark -generate file [-bytes n] [-single] [-seed n] [-depth n] [-let p] [-call p]
+ *           [-recursion none|linear|tree] [-recursion-depth n]
+ * benchmark -scaling [-max-size n] [-only stage]
+ * benchmark -startup path/to/main [-runs n] [-budget us] [-floor path]
+ *
+ * Times `parse`, `optimize`, `interpret` and `Step::interpBySteps` on
+ * each canonical workload and prints the results as JSON on standard
+ * output. Every stage is repeated until it has at least `n` samples
+ * (10 by default, 3 with `-quick`) and has run for at least 250 ms
+ * (20 ms with `-quick`), so the median and the 95% confidence
+ * interval of the mean are meaningful. Hardware counters per run are
+ * included when `PerfCounters` can read them.
+ *
+ * With `-compare`, also compares the run with a baseline saved from an
+ * earlier one, printing each benchmark's change on standard error and
+ * exiting with 1 if any regressed: became more than `percent` slower
+ * (5 by default) with a Mann-Whitney p-value below `p` (0.01 by
+ * default), or is missing from the run, so a renamed or dropped
+ * workload cannot pass unnoticed; `-allow-missing` lets it. With
+ * `-only`, only that workload's baseline is compared.
+ * `-compare-files` compares two saved runs without running anything.
+ *
+ * With `-generate`, instead writes `n` bytes (1 MB by default) of
+ * random programs to `file`, one per line, or one program of that size
+ * with `-single`; the other flags set the `GeneratorOptions`. The same
+ * flags always write the same file.
+ *
+ * With `-scaling`, instead checks how each stage's time grows with the
+ * size of its input; see `scalingMain`. With `-startup`, instead times
+ * starting `main` on a trivial program; see `startupMain`.
+ */
+
+class Options {
+public:
+    int minSamples = 10;
+    int maxSamples = 1000;
+    std::chrono::milliseconds minTime = std::chrono::milliseconds(250);
+    std::string only;
+    std::string baseline;
+    double threshold = 0.05;
+    double alpha = 0.01;
+    bool allowMissing = false;
+
+    /**
+     * @return whether `argv[i]` is a comparison flag, reading it and its value.
+     */
+    bool comparisonFlag(int argc, char **argv, int &i);
+};
+
+bool Options::comparisonFlag(int argc, char **argv, int &i) {
+    if (strcmp(argv[i], "-threshold") == 0 && i + 1 < argc && atof(argv[i + 1]) >= 0) {
+        threshold = atof(argv[++i]) / 100;
+    } else if (strcmp(argv[i], "-alpha") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0) {
+        alpha = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-allow-missing") == 0) {
+        allowMissing = true;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * The timings of one stage of one workload.
+ */
+class Measurement {
+public:
+    std::string workload;
+    std::string stage;
+    std::vector<long> samples; /* nanoseconds per run */
+    PerfCounters::Sample counters; /* summed over all samples */
+};
+
+/**
+ * Runs `run` until `options` are satisfied, after one untimed warm-up run.
+ */
+static Measurement measure(const std::string &workload, const std::string &stage,
+                           const std::function<void()> &run, const Options &options) {
+    Measurement measurement;
+    measurement.workload = workload;
+    measurement.stage = stage;
+    run();
+
+    PerfCounters counters;
+    auto started = std::chrono::steady_clock::now();
+    {
+        PerfCounters::Phase phase(counters, stage);
+        while ((int) measurement.samples.size() < options.maxSamples
+               && ((int) measurement.samples.size() < options.minSamples
+                   || std::chrono::steady_clock::now() - started < options.minTime)) {
+            auto begin = std::chrono::steady_clock::now();
+            run();
+            auto end = std::chrono::steady_clock::now();
+            measurement.samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+        }
+    }
+    measurement.counters = counters.phases()[0].second;
+    return measurement;
+}
+
+static double mean(const std::vector<long> &samples) {
+    double sum = 0;
+    for (long sample : samples)
+        sum += sample;
+    return sum / samples.size();
+}
+
+static double standardDeviation(const std::vector<long> &samples) {
+    if (samples.size() < 2)
+        return 0;
+    double average = mean(samples);
+    double squares = 0;
+    for (long sample : samples)
+        squares += (sample - average) * (sample - average);
+    return std::sqrt(squares / (samples.size() - 1));
+}
+
+static std::string json(const Measurement &measurement) {
+    std::ostringstream out;
+    const std::vector<long> &samples = measurement.samples;
+    double deviation = standardDeviation(samples);
+    out << "{\"workload\":\"" << measurement.workload << "\",\"stage\":\"" << measurement.stage << "\""
+        << ",\"runs\":" << samples.size()
+        << ",\"median_ns\":" << (long) median(samples)
+        << ",\"mean_ns\":" << (long) mean(samples)
+        << ",\"stddev_ns\":" << (long) deviation
+        << ",\"ci95_ns\":" << (long) (1.96 * deviation / std::sqrt((double) samples.size()))
+        << ",\"min_ns\":" << *std::min_element(samples.begin(), samples.end());
+
+    static const char *counterNames[PerfCounters::counterKinds] = {
+            "cycles", "instructions", "cache_misses", "branch_misses"
+    };
+    for (int kind = 0; kind < PerfCounters::counterKinds; kind++) {
+        long count = measurement.counters.counts[kind];
+        if (count >= 0)
+            out << ",\"" << counterNames[kind] << "_per_run\":" << count / (long) samples.size();
+    }
+    if (measurement.counters.ipc() > 0)
+        out << ",\"ipc\":" << measurement.counters.ipc();
+
+    out << ",\"samples_ns\":[";
+    for (size_t i = 0; i < samples.size(); i++)
+        out << (i == 0 ? "" : ",") << samples[i];
+    out << "]}";
+    return out.str();
+}
+
+/**
+ * @return the results saved in `file`.
+ * @throws std::runtime_error if it cannot be read.
+ */
+static std::vector<BenchmarkResult> readResultsFile(const std::string &file) {
+    std::ifstream in(file);
+    if (!in)
+        throw std::runtime_error("cannot read " + file);
+    return readResults(in);
+}
+
+/**
+ * Prints the comparison of `current` with `baseline`.
+ * @return 1 if any benchmark regressed or, unless allowed, is missing;
+ * 0 otherwise.
+ */
+static int compare(const std::vector<BenchmarkResult> &baseline, const std::vector<BenchmarkResult> &current,
+                   const Options &options) {
+    std::vector<Comparison> comparisons = compareResults(baseline, current, options.threshold, options.alpha);
+    std::cerr << comparisonReport(comparisons);
+    int regressions = 0;
+    int missing = 0;
+    for (const Comparison &comparison : comparisons) {
+        regressions += comparison.regressed;
+        missing += comparison.missing;
+    }
+    if (regressions > 0)
+        std::cerr << regressions << " regressed" << std::endl;
+    if (missing > 0)
+        std::cerr << missing << " missing" << (options.allowMissing ? " (allowed)" : "") << std::endl;
+    return regressions > 0 || (missing > 0 && !options.allowMissing) ? 1 : 0;
+}
+
+/**
+ * Runs `benchmark -compare-files`.
+ */
+static int compareFiles(int argc, char **argv) {
+    Options options;
+    for (int i = 4; i < argc; i++) {
+        if (!options.comparisonFlag(argc, argv, i)) {
+            std::cerr << "bad compare flag " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    try {
+        return compare(readResultsFile(argv[2]), readResultsFile(argv[3]), options);
+    } catch (std::runtime_error &exn) {
+        std::cerr << exn.what() << std::endl;
+        return 1;
+    }
+}
+
+/**
+ * Runs `benchmark -generate`.
+ */
+static int generate(int argc, char **argv) {
+    const char *file = argv[2];
+    GeneratorOptions options;
+    long bytes = 1L << 20;
+    bool single = false;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "-bytes") == 0 && i + 1 < argc && atol(argv[i + 1]) > 0) {
+            bytes = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-single") == 0) {
+            single = true;
+        } else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+            options.seed = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "-depth") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            options.depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-let") == 0 && i + 1 < argc) {
+            options.letDensity = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-call") == 0 && i + 1 < argc) {
+            options.callDensity = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-recursion") == 0 && i + 1 < argc && options.recursionFromName(argv[i + 1])) {
+            i++;
+        } else if (strcmp(argv[i], "-recursion-depth") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 0) {
+            options.recursionDepth = atoi(argv[++i]);
+        } else {
+            std::cerr << "bad generate flag " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    std::ofstream out(file, std::ios::binary);
+    ProgramGenerator generator(options);
+    long written = single ? generator.writeSingle(out, bytes) : generator.write(out, bytes);
+    out.close();
+    if (!out) {
+        std::cerr << "cannot write " << file << std::endl;
+        return 1;
+    }
+    std::cerr << written << " bytes written to " << file << std::endl;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 3 && strcmp(argv[1], "-generate") == 0)
+        return generate(argc, argv);
+    if (argc >= 2 && strcmp(argv[1], "-scaling") == 0)
+        return scalingMain(argc, argv);
+    if (argc >= 2 && strcmp(argv[1], "-startup") == 0)
+        return startupMain(argc, argv);
+    if (argc >= 4 && strcmp(argv[1], "-compare-files") == 0)
+        return compareFiles(argc, argv);
+
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-quick") == 0) {
+            options.minSamples = 3;
+            options.minTime = std::chrono::milliseconds(20);
+        } else if (strcmp(argv[i], "-samples") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            options.minSamples = atoi(argv[++i]);
+            options.maxSamples = std::max(options.maxSamples, options.minSamples);
+        } else if (strcmp(argv[i], "-only") == 0 && i + 1 < argc) {
+            options.only = argv[++i];
+        } else if (strcmp(argv[i], "-compare") == 0 && i + 1 < argc) {
+            options.baseline = argv[++i];
+        } else if (!options.comparisonFlag(argc, argv, i)) {
+            std::cerr << "usage: benchmark [-quick] [-samples n] [-only workload] [-compare baseline.json]"
+                         " [-threshold percent] [-alpha p] [-allow-missing]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<BenchmarkResult> baseline;
+    if (!options.baseline.empty()) {
+        try {
+            baseline = readResultsFile(options.baseline);
+        } catch (std::runtime_error &exn) {
+            std::cerr << exn.what() << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<Measurement> measurements;
+    for (const Workload &workload : canonicalWorkloads()) {
+        if (!options.only.empty() && workload.name != options.only)
+            continue;
+        try {
+            PTR(Expression) parsed = parseSource(workload.source);
+            std::string interpreted = parsed->interpret(Environment::empty())->toString();
+            std::string stepped = Step::interpBySteps(parsed)->toString();
+            if (interpreted != workload.expected || stepped != workload.expected) {
+                std::cerr << workload.name << ": expected " << workload.expected << ", interpreted "
+                          << interpreted << ", by steps " << stepped << std::endl;
+                return 1;
+            }
+
+            measurements.push_back(measure(workload.name, "parse", [&workload] {
+                parseSource(workload.source);
+            }, options));
+            measurements.push_back(measure(workload.name, "optimize", [&parsed] {
+                parsed->optimize();
+            }, options));
+            measurements.push_back(measure(workload.name, "interp", [&parsed] {
+                parsed->interpret(Environment::empty());
+            }, options));
+            measurements.push_back(measure(workload.name, "step", [&parsed] {
+                Step::interpBySteps(parsed);
+            }, options));
+        } catch (std::runtime_error &exn) {
+            std::cerr << workload.name << ": " << exn.what() << std::endl;
+            return 1;
+        }
+    }
+
+    PerfCounters probe;
+    std::cout << "{\"counters_available\":" << (probe.available() ? "true" : "false") << ",\"benchmarks\":[";
+    for (size_t i = 0; i < measurements.size(); i++)
+        std::cout << (i == 0 ? "\n" : ",\n") << json(measurements[i]);
+    std::cout << "\n]}" << std::endl;
+
+    if (options.baseline.empty())
+        return 0;
+    std::vector<BenchmarkResult> current;
+    for (const Measurement &measurement : measurements)
+        current.push_back({measurement.workload, measurement.stage, measurement.samples});
+    if (!options.only.empty()) {
+        /* the other workloads were left out on purpose, not dropped */
+        baseline.erase(std::remove_if(baseline.begin(), baseline.end(), [&options](const BenchmarkResult &result) {
+            return result.workload != options.only;
+        }), baseline.end());
+    }
+    return compare(baseline, current, options);
+}
@@ -0,0 +1,227 @@
+#include <sstream>
+#include <utility>
+#include "generator.hpp"
+#include "workloads.hpp"
+#include "../ArithmeticParser/parse.h"
+#include "../ArithmeticParser/expression.hpp"
+#include "../ArithmeticParser/Environment.h"
+#include "../ArithmeticParser/value.h"
+#include "../ArithmeticParser/step.h"
+#include "../catch/catch.hpp"
+
+bool GeneratorOptions::recursionFromName(const std::string &name) {
+    if (name == "none")
+        recursion = NoRecursion;
+    else if (name == "linear")
+        recursion = LinearRecursion;
+    else if (name == "tree")
+        recursion = TreeRecursion;
+    else
+        return false;
+    return true;
+}
+
+ProgramGenerator::ProgramGenerator(GeneratorOptions options) {
+    this->options = std::move(options);
+    this->state = this->options.seed;
+    this->names = 0;
+}
+
+uint64_t splitmix64(uint64_t x) {
+    uint64_t z = x + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+uint64_t ProgramGenerator::next() {
+    uint64_t z = splitmix64(state);
+    state += 0x9e3779b97f4a7c15ULL;
+    return z;
+}
+
+bool ProgramGenerator::chance(double probability) {
+    return (next() >> 11) * (1.0 / 9007199254740992.0) < probability;
+}
+
+int ProgramGenerator::below(int n) {
+    return (int) (next() % (uint64_t) n);
+}
+
+std::string ProgramGenerator::fresh() {
+    return variableName('v', names++);
+}
+
+std::string ProgramGenerator::literal() {
+    return std::to_string(below(19) - 9);
+}
+
+std::string ProgramGenerator::program() {
+    names = 0;
+    std::vector<std::string> numbers;
+    std::vector<std::string> functions;
+    if (options.recursion == GeneratorOptions::NoRecursion)
+        return expression(options.depth, numbers, functions);
+
+    std::string function = fresh();
+    std::string n = fresh();
+    numbers.push_back(n);
+    std::string work = operand(options.depth - 1, numbers, functions);
+    std::string self = function + "(" + function + ")";
+    std::string recurse = self + "(" + n + " + -1)";
+    std::string base = "_if " + n + " == 0 _then 0 _else ";
+    if (options.recursion == GeneratorOptions::TreeRecursion) {
+        base += "_if " + n + " == 1 _then 1 _else ";
+        recurse += " + " + self + "(" + n + " + -2)";
+    }
+    return "_let " + function + " = _fun (" + function + ") _fun (" + n + ") " + base + work + " + " + recurse
+           + " _in " + self + "(" + std::to_string(options.recursionDepth) + ")";
+}
+
+/**
+ * @return a number-valued expression at most `depth` operators deep,
+ * using only the variables in `numbers` and `functions`.
+ */
+std::string ProgramGenerator::expression(int depth, std::vector<std::string> &numbers,
+                                         std::vector<std::string> &functions) {
+    if (depth <= 0 || chance(0.15)) {
+        if (!numbers.empty() && chance(0.5))
+            return numbers[below((int) numbers.size())];
+        return literal();
+    }
+
+    if (chance(options.letDensity)) {
+        std::string name = fresh();
+        if (chance(options.callDensity)) {
+            std::string parameter = fresh();
+            numbers.push_back(parameter);
+            std::string body = operand(depth - 1, numbers, functions);
+            numbers.pop_back();
+            functions.push_back(name);
+            std::string rest = expression(depth - 1, numbers, functions);
+            functions.pop_back();
+            return "_let " + name + " = _fun (" + parameter + ") " + body + " _in " + rest;
+        }
+        std::string value = operand(depth - 1, numbers, functions);
+        numbers.push_back(name);
+        std::string rest = expression(depth - 1, numbers, functions);
+        numbers.pop_back();
+        return "_let " + name + " = " + value + " _in " + rest;
+    }
+
+    if (chance(options.callDensity)) {
+        std::string argument = expression(depth - 1, numbers, functions);
+        if (!functions.empty() && chance(0.5))
+            return functions[below((int) functions.size())] + "(" + argument + ")";
+        std::string parameter = fresh();
+        numbers.push_back(parameter);
+        std::string body = operand(depth - 1, numbers, functions);
+        numbers.pop_back();
+        return "(_fun (" + parameter + ") " + body + ")(" + argument + ")";
+    }
+
+    switch (below(4)) {
+        case 0:
+            return "_if " + operand(depth - 1, numbers, functions) + " == " + operand(depth - 1, numbers, functions)
+                   + " _then " + operand(depth - 1, numbers, functions)
+                   + " _else " + expression(depth - 1, numbers, functions);
+        case 1:
+            return std::to_string(below(2)) + " * " + operand(depth - 1, numbers, functions);
+        default:
+            return operand(depth - 1, numbers, functions) + " + " + operand(depth - 1, numbers, functions);
+    }
+}
+
+/**
+ * @return `expression`, parenthesized unless it is a single token, so
+ * it can be an operand without a trailing `_let`, `_if` or `_fun`
+ * taking in what follows it.
+ */
+std::string ProgramGenerator::operand(int depth, std::vector<std::string> &numbers,
+                                      std::vector<std::string> &functions) {
+    std::string e = expression(depth, numbers, functions);
+    if (e.find(' ') == std::string::npos)
+        return e;
+    return "(" + e + ")";
+}
+
+long ProgramGenerator::write(std::ostream &out, long bytes, char delimiter) {
+    long written = 0;
+    while (written < bytes && out) {
+        std::string text = program();
+        out << text << delimiter;
+        written += (long) text.size() + 1;
+    }
+    return written;
+}
+
+long ProgramGenerator::writeSingle(std::ostream &out, long bytes) {
+    std::vector<std::string> numbers;
+    std::vector<std::string> functions;
+    std::string previous;
+    long written = 0;
+    do {
+        std::string name = fresh();
+        std::string text = "_let " + name + " = " + operand(options.depth, numbers, functions);
+        if (!previous.empty())
+            text += " + 0 * " + previous;
+        text += " _in ";
+        out << text;
+        written += (long) text.size();
+        previous = name;
+    } while (written < bytes && out);
+    out << previous << "\n";
+    return written + (long) previous.size() + 1;
+}
+
+TEST_CASE("splitmix64") {
+    /* the first outputs of the reference generator seeded with 0 */
+    CHECK(splitmix64(0) == 0xe220a8397b1dcdafULL);
+    CHECK(splitmix64(0x9e3779b97f4a7c15ULL) == 0x6e789e6aa1b965f4ULL);
+}
+
+TEST_CASE("ProgramGenerator is deterministic") {
+    GeneratorOptions options;
+    options.seed = 42;
+    ProgramGenerator first(options);
+    ProgramGenerator second(options);
+    options.seed = 43;
+    ProgramGenerator other(options);
+    bool differs = false;
+    for (int i = 0; i < 20; i++) {
+        std::string program = first.program();
+        CHECK(second.program() == program);
+        differs = differs || other.program() != program;
+    }
+    CHECK(differs);
+
+    std::ostringstream out;
+    [[maybe_unused]] long written = ProgramGenerator(options).write(out, 1000, ';');
+    CHECK(written >= 1000);
+    CHECK((long) out.str().size() == written);
+    CHECK(out.str().back() == ';');
+}
+
+TEST_CASE("ProgramGenerator programs evaluate to numbers") {
+    for ([[maybe_unused]] const char *recursion : {"none", "linear", "tree"}) {
+        GeneratorOptions options;
+        REQUIRE(options.recursionFromName(recursion));
+        options.recursionDepth = 5;
+        for (uint64_t seed = 1; seed <= 3; seed++) {
+            options.seed = seed;
+            ProgramGenerator generator(options);
+            for (int i = 0; i < 30; i++) {
+                PTR(Expression) program = parseSource(generator.program());
+                PTR(Value) value = program->interpret(NEW(EmptyEnv)());
+                CHECK(CAST(NumberValue)(value) != nullptr);
+                CHECK(Step::interpBySteps(program)->toString() == value->toString());
+            }
+        }
+    }
+    GeneratorOptions options;
+    CHECK(!options.recursionFromName("mutual"));
+
+    std::ostringstream out;
+    CHECK(ProgramGenerator(options).writeSingle(out, 5000) >= 5000);
+    CHECK(CAST(NumberValue)(Step::interpBySteps(parseSource(out.str()))) != nullptr);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @return the splitmix64 output for state `x`, the generator behind
+ * `ProgramGenerator`; unlike the distributions in <random>, it is fully
+ * specified, so it gives the same numbers on every platform.
+ */
+extern uint64_t splitmix64(uint64_t x);
+
+/**
+ * The shape of the programs a `ProgramGenerator` makes.
+ */
+class GeneratorOptions {
+public:
+    typedef enum {
+        NoRecursion,
+        LinearRecursion, /* one recursive call per level, like countUp */
+        TreeRecursion    /* two recursive calls per level, like fib */
+    } recursionT;
+
+    uint64_t seed = 1;
+    int depth = 6;            /* most nested operators in an expression */
+    double letDensity = 0.2;  /* chance that an operator is a `_let` */
+    double callDensity = 0.1; /* chance that an operator is a function call */
+    recursionT recursion = NoRecursion;
+    int recursionDepth = 10;  /* argument of the recursive function */
+
+    /**
+     * @return whether `name` is `none`, `linear` or `tree`, setting `recursion`.
+     */
+    bool recursionFromName(const std::string &name);
+};
+
+/**
+ * Makes random MSDScript programs for load tests. The same seed and
+ * options always give the same programs, on any platform, since the
+ * generator uses its own random number generator.
+ *
+ * Every program is a single line and evaluates to a number without
+ * errors: variables are only used where bound and functions are only
+ * called. Literals are between -9 and 9 and a product always has a
+ * literal 0 or 1 as one operand, so results stay small.
+ */
+class ProgramGenerator {
+public:
+    explicit ProgramGenerator(GeneratorOptions options);
+
+    /**
+     * @return the next program.
+     */
+    std::string program();
+
+    /**
+     * Writes programs, each followed by `delimiter`, until at least `bytes` are written.
+     * @return the bytes written.
+     */
+    long write(std::ostream &out, long bytes, char delimiter = '\n');
+
+    /**
+     * Writes one program of at least `bytes`: a chain of `_let`s, each
+     * bound value also using the one before. Its nesting grows with its
+     * size, so a very large one needs step mode to evaluate.
+     * @return the bytes written.
+     */
+    long writeSingle(std::ostream &out, long bytes);
+
+private:
+    GeneratorOptions options;
+    uint64_t state;
+    long names;
+
+    uint64_t next();
+
+    bool chance(double probability);
+
+    int below(int n);
+
+    std::string fresh();
+
+    std::string literal();
+
+    std::string expression(int depth, std::vector<std::string> &numbers, std::vector<std::string> &functions);
+
+    std::string operand(int depth, std::vector<std::string> &numbers, std::vector<std::string> &functions);
+};
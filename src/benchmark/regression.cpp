@@ -0,0 +1,331 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include "regression.hpp"
+#include "../catch/catch.hpp"
+
+/**
+ * Just enough of a JSON reader for `benchmark` output: it checks the
+ * syntax of every value but keeps only the fields of `BenchmarkResult`.
+ */
+class JsonReader {
+public:
+    explicit JsonReader(std::string text) {
+        this->text = std::move(text);
+        this->at = 0;
+    }
+
+    std::vector<BenchmarkResult> results() {
+        std::vector<BenchmarkResult> results;
+        bool found = false;
+        expect('{');
+        if (!consume('}')) {
+            do {
+                std::string key = string();
+                expect(':');
+                if (key == "benchmarks") {
+                    found = true;
+                    expect('[');
+                    if (!consume(']')) {
+                        do {
+                            results.push_back(result());
+                        } while (consume(','));
+                        expect(']');
+                    }
+                } else {
+                    skipValue();
+                }
+            } while (consume(','));
+            expect('}');
+        }
+        skipSpace();
+        if (at != text.size())
+            fail("trailing text");
+        if (!found)
+            fail("no benchmarks");
+        return results;
+    }
+
+private:
+    std::string text;
+    size_t at;
+
+    [[noreturn]] void fail(const std::string &what) {
+        throw std::runtime_error("bad benchmark JSON at byte " + std::to_string(at) + ": " + what);
+    }
+
+    void skipSpace() {
+        while (at < text.size() && isspace((unsigned char) text[at]))
+            at++;
+    }
+
+    bool consume(char c) {
+        skipSpace();
+        if (at < text.size() && text[at] == c) {
+            at++;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c) {
+        if (!consume(c))
+            fail(std::string("expected ") + c);
+    }
+
+    std::string string() {
+        expect('"');
+        std::string value;
+        while (at < text.size() && text[at] != '"') {
+            if (text[at] == '\\' && at + 1 < text.size())
+                at++;
+            value += text[at++];
+        }
+        if (at == text.size())
+            fail("unterminated string");
+        at++;
+        return value;
+    }
+
+    double number() {
+        skipSpace();
+        const char *begin = text.c_str() + at;
+        char *end;
+        double value = strtod(begin, &end);
+        if (end == begin)
+            fail("expected a number");
+        at += end - begin;
+        return value;
+    }
+
+    void skipValue() {
+        skipSpace();
+        if (at == text.size())
+            fail("expected a value");
+        char c = text[at];
+        if (c == '"') {
+            string();
+        } else if (c == '{' || c == '[') {
+            char close = c == '{' ? '}' : ']';
+            at++;
+            if (consume(close))
+                return;
+            do {
+                if (close == '}') {
+                    string();
+                    expect(':');
+                }
+                skipValue();
+            } while (consume(','));
+            expect(close);
+        } else if (text.compare(at, 4, "true") == 0 || text.compare(at, 4, "null") == 0) {
+            at += 4;
+        } else if (text.compare(at, 5, "false") == 0) {
+            at += 5;
+        } else {
+            number();
+        }
+    }
+
+    BenchmarkResult result() {
+        BenchmarkResult result;
+        expect('{');
+        if (!consume('}')) {
+            do {
+                std::string key = string();
+                expect(':');
+                if (key == "workload") {
+                    result.workload = string();
+                } else if (key == "stage") {
+                    result.stage = string();
+                } else if (key == "samples_ns") {
+                    expect('[');
+                    if (!consume(']')) {
+                        do {
+                            result.samples.push_back((long) number());
+                        } while (consume(','));
+                        expect(']');
+                    }
+                } else {
+                    skipValue();
+                }
+            } while (consume(','));
+            expect('}');
+        }
+        if (result.workload.empty() || result.stage.empty() || result.samples.empty())
+            fail("a benchmark needs a workload, a stage and samples");
+        return result;
+    }
+};
+
+std::vector<BenchmarkResult> readResults(std::istream &in) {
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return JsonReader(text).results();
+}
+
+double median(std::vector<long> samples) {
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    return n % 2 == 1 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2.0;
+}
+
+double mannWhitney(const std::vector<long> &a, const std::vector<long> &b) {
+    if (a.empty() || b.empty())
+        return 1;
+    std::vector<std::pair<long, bool>> pooled; /* sample, whether from `a` */
+    for (long sample : a)
+        pooled.emplace_back(sample, true);
+    for (long sample : b)
+        pooled.emplace_back(sample, false);
+    std::sort(pooled.begin(), pooled.end());
+
+    /* tied samples share the mean of their ranks */
+    double n = (double) pooled.size();
+    double rankSumA = 0;
+    double ties = 0;
+    for (size_t i = 0; i < pooled.size();) {
+        size_t j = i;
+        while (j < pooled.size() && pooled[j].first == pooled[i].first)
+            j++;
+        double rank = (i + 1 + j) / 2.0;
+        for (size_t k = i; k < j; k++)
+            if (pooled[k].second)
+                rankSumA += rank;
+        double t = (double) (j - i);
+        ties += t * t * t - t;
+        i = j;
+    }
+
+    double na = (double) a.size();
+    double nb = (double) b.size();
+    double u = rankSumA - na * (na + 1) / 2;
+    double mean = na * nb / 2;
+    double variance = na * nb / 12 * ((n + 1) - ties / (n * (n - 1)));
+    if (variance <= 0)
+        return 1;
+    double z = std::max(0.0, std::fabs(u - mean) - 0.5) / std::sqrt(variance);
+    return std::erfc(z / std::sqrt(2.0));
+}
+
+std::vector<Comparison> compareResults(const std::vector<BenchmarkResult> &baseline,
+                                       const std::vector<BenchmarkResult> &current,
+                                       double threshold, double alpha) {
+    std::vector<Comparison> comparisons;
+    for (const BenchmarkResult &before : baseline) {
+        Comparison comparison;
+        comparison.workload = before.workload;
+        comparison.stage = before.stage;
+        comparison.baselineMedian = median(before.samples);
+        comparison.currentMedian = -1;
+        comparison.delta = 0;
+        comparison.pValue = 1;
+        comparison.regressed = false;
+        comparison.improved = false;
+        comparison.missing = true;
+        for (const BenchmarkResult &after : current) {
+            if (after.workload != before.workload || after.stage != before.stage)
+                continue;
+            comparison.missing = false;
+            comparison.currentMedian = median(after.samples);
+            comparison.delta = comparison.currentMedian / comparison.baselineMedian - 1;
+            comparison.pValue = mannWhitney(before.samples, after.samples);
+            bool significant = comparison.pValue < alpha;
+            comparison.regressed = significant && comparison.delta > threshold;
+            comparison.improved = significant && comparison.delta < -threshold;
+            break;
+        }
+        comparisons.push_back(comparison);
+    }
+    return comparisons;
+}
+
+std::string comparisonReport(const std::vector<Comparison> &comparisons) {
+    std::ostringstream out;
+    out << "workload stage baseline_ns current_ns delta p result\n";
+    for (const Comparison &comparison : comparisons) {
+        out << comparison.workload << " " << comparison.stage << " " << (long) comparison.baselineMedian << " ";
+        if (comparison.missing) {
+            out << "- - - MISSING\n";
+            continue;
+        }
+        out << (long) comparison.currentMedian << " " << std::showpos << std::fixed << std::setprecision(1)
+            << comparison.delta * 100 << "%" << std::noshowpos << std::defaultfloat << std::setprecision(2) << " "
+            << comparison.pValue << " "
+            << (comparison.regressed ? "REGRESSED" : comparison.improved ? "improved" : "same") << "\n";
+    }
+    return out.str();
+}
+
+TEST_CASE("mannWhitney") {
+    /* U = 0 for two samples of five: z = 12 / sqrt(25 * 11 / 12) with the continuity correction */
+    CHECK(mannWhitney({1, 2, 3, 4, 5}, {6, 7, 8, 9, 10}) == Approx(0.0122).margin(0.0001));
+    CHECK(mannWhitney({6, 7, 8, 9, 10}, {1, 2, 3, 4, 5}) == Approx(0.0122).margin(0.0001));
+    CHECK(mannWhitney({1, 3, 5, 7, 9}, {2, 4, 6, 8, 10}) > 0.5);
+    CHECK(mannWhitney({4, 4, 4}, {4, 4, 4}) == 1);
+    CHECK(mannWhitney({}, {1, 2}) == 1);
+}
+
+TEST_CASE("median") {
+    CHECK(median({3, 1, 2}) == 2);
+    CHECK(median({4, 1, 3, 2}) == 2.5);
+}
+
+TEST_CASE("readResults") {
+    std::istringstream good("{\"seed\": 7, \"host\": {\"cpus\": [1, 2], \"name\": \"a \\\"b\\\"\"},\n"
+                            " \"ok\": true, \"note\": null,\n"
+                            " \"benchmarks\": [\n"
+                            "  {\"workload\": \"tree\", \"stage\": \"parse\", \"bytes\": 1e3, \"samples_ns\": [30, 10, 20]},\n"
+                            "  {\"workload\": \"tree\", \"stage\": \"step\", \"warm\": false, \"samples_ns\": [5]}\n"
+                            " ]}\n");
+    std::vector<BenchmarkResult> results = readResults(good);
+    REQUIRE(results.size() == 2);
+    CHECK(results[0].workload == "tree");
+    CHECK(results[0].stage == "parse");
+    CHECK(results[0].samples == std::vector<long>({30, 10, 20}));
+    CHECK(results[1].stage == "step");
+    CHECK(results[1].samples == std::vector<long>({5}));
+
+    std::istringstream empty("{\"benchmarks\": []}");
+    CHECK(readResults(empty).empty());
+
+    for (const char *bad : {"", "{}", "{\"benchmarks\": [}", "{\"benchmarks\": []} x",
+                            "{\"benchmarks\": [{\"workload\": \"tree\", \"samples_ns\": [1]}]}",
+                            "{\"benchmarks\": [{\"workload\": \"tree\", \"stage\": \"parse\", \"samples_ns\": [a]}]}",
+                            "{\"benchmarks\": [], \"name\": \"unterminated}"}) {
+        std::istringstream in(bad);
+        CHECK_THROWS_AS(readResults(in), std::runtime_error);
+    }
+}
+
+TEST_CASE("compareResults") {
+    std::vector<long> fast = {100, 101, 102, 103, 104, 105, 106, 107, 108, 109};
+    std::vector<long> slow;
+    for (long sample : fast)
+        slow.push_back(sample * 12 / 10);
+    std::vector<BenchmarkResult> baseline = {{"tree", "parse", fast}, {"tree", "step", slow}, {"list", "parse", fast}};
+    std::vector<BenchmarkResult> current = {{"tree", "parse", slow}, {"tree", "step", fast}};
+
+    std::vector<Comparison> comparisons = compareResults(baseline, current, 0.05, 0.01);
+    REQUIRE(comparisons.size() == 3);
+    CHECK(comparisons[0].regressed);
+    CHECK(!comparisons[0].improved);
+    CHECK(comparisons[0].delta == Approx(0.2).margin(0.01));
+    CHECK(comparisons[1].improved);
+    CHECK(!comparisons[1].regressed);
+    CHECK(comparisons[2].missing);
+    CHECK(!comparisons[2].regressed);
+
+    std::string report = comparisonReport(comparisons);
+    CHECK(report.find("tree parse 104 125 +19.6%") != std::string::npos);
+    CHECK(report.find("REGRESSED") != std::string::npos);
+    CHECK(report.find("list parse 104 - - - MISSING") != std::string::npos);
+
+    /* a change under the threshold is not a regression however significant */
+    CHECK(!compareResults(baseline, {{"tree", "parse", fast}}, 0.05, 0.01)[0].regressed);
+}
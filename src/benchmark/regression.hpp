@@ -0,0 +1,71 @@
+#pragma once
+
+#include <istream>
+#include <string>
+#include <vector>
+
+/**
+ * The samples of one stage of one workload, as `benchmark` prints them.
+ */
+class BenchmarkResult {
+public:
+    std::string workload;
+    std::string stage;
+    std::vector<long> samples; /* nanoseconds per run */
+};
+
+/**
+ * How one benchmark changed between a baseline and a current run.
+ */
+class Comparison {
+public:
+    std::string workload;
+    std::string stage;
+    double baselineMedian; /* nanoseconds */
+    double currentMedian;  /* nanoseconds; -1 if the current run lacks it */
+    double delta;          /* relative change of the median, 0.1 for 10% slower */
+    double pValue;         /* two-sided Mann-Whitney p-value of the difference */
+    bool regressed;
+    bool improved;
+    bool missing;          /* the current run lacks this benchmark */
+};
+
+/**
+ * Reads the benchmarks from the JSON `benchmark` prints. Only the
+ * `workload`, `stage` and `samples_ns` of each are read; other fields
+ * are skipped, so baselines stay readable as the output grows.
+ *
+ * @throws std::runtime_error if `in` is not such JSON.
+ */
+extern std::vector<BenchmarkResult> readResults(std::istream &in);
+
+/**
+ * @return the median of `samples`, the mean of the middle two if there
+ * is an even number of them.
+ */
+extern double median(std::vector<long> samples);
+
+/**
+ * @return the two-sided p-value of the Mann-Whitney U test that `a`
+ * and `b` come from the same distribution, by the normal approximation
+ * with a correction for ties. Needs about eight samples on each side
+ * to reach p < 0.01.
+ */
+extern double mannWhitney(const std::vector<long> &a, const std::vector<long> &b);
+
+/**
+ * Compares each baseline benchmark with the current one of the same
+ * workload and stage. A benchmark regressed if its median is more than
+ * `threshold` slower and the difference is significant at `alpha`, and
+ * improved if it is as much faster just as significantly. A baseline
+ * benchmark the current run lacks is marked missing.
+ */
+extern std::vector<Comparison> compareResults(const std::vector<BenchmarkResult> &baseline,
+                                              const std::vector<BenchmarkResult> &current,
+                                              double threshold, double alpha);
+
+/**
+ * @return a `workload stage baseline_ns current_ns delta p result`
+ * header and one line per comparison.
+ */
+extern std::string comparisonReport(const std::vector<Comparison> &comparisons);
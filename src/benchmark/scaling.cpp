@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "scaling.hpp"
+#include "workloads.hpp"
+#include "../ArithmeticParser/parse.h"
+#include "../ArithmeticParser/expression.hpp"
+#include "../ArithmeticParser/Environment.h"
+#include "../ArithmeticParser/step.h"
+
+typedef enum {
+    ParseStage,
+    OptimizeStage,
+    PrintStage,
+    InterpStage,
+    StepStage
+} stageT;
+
+static const char *stageNames[] = {"parse", "optimize", "print", "interp", "step"};
+
+/**
+ * One stage run on one family of programs, and how fast its time may grow.
+ */
+class ScalingCase {
+public:
+    std::string family;
+    stageT stage;
+    std::function<std::string(int)> program; /* the program of a given size */
+    double declared;                         /* the exponent of the declared complexity */
+    int maxSize;                             /* the most the native stack allows, or 0 for no limit */
+};
+
+/**
+ * Sizes too small to time reliably are not fitted, and a stage stops
+ * growing once a run is slower than `maxRunNanos`.
+ */
+static const double noiseFloorNanos = 20e3;
+static const double maxRunNanos = 1e9;
+static const double tolerance = 0.35;
+
+/**
+ * The parser keeps its own stack and expressions are released without
+ * recursing, so parsing is not limited. The step interpreter is not
+ * limited either, but the environment chains it builds are released
+ * one native frame per binding, and the printer, the recursive
+ * interpreter and the optimizer, which calls it on closed
+ * subexpressions, recurse once per level with larger frames, so nested
+ * inputs stay well inside a default 8 MB stack. `curriedCall` nests
+ * twice as deep as its size.
+ */
+static const int nativeNesting = 100000;
+static const int interpNesting = 10000;
+
+static std::vector<ScalingCase> scalingCases() {
+    std::vector<ScalingCase> cases;
+    for (stageT stage : {ParseStage, OptimizeStage, PrintStage, InterpStage, StepStage}) {
+        int nested = stage == ParseStage ? 0 : stage == StepStage ? nativeNesting : interpNesting;
+        /* `toString` copies each subexpression's text into its parent's,
+         * so printing a chain copies each term once per level above it. */
+        double printed = stage == PrintStage ? 2.0 : 1.0;
+        cases.push_back({"addChain", stage, addChainProgram, printed, nested});
+        /* its body looks up each of its `n` parameters through an
+         * environment `n` bindings long */
+        bool evaluated = stage == InterpStage || stage == StepStage;
+        cases.push_back({"curriedCall", stage, curriedCallProgram, evaluated ? 2.0 : printed, nested});
+        /* `LetExpression::optimize` substitutes each closed binding into
+         * an already optimized body and optimizes the result again. */
+        cases.push_back({"letNest", stage, letNestProgram, stage == OptimizeStage ? 2.0 : printed, nested});
+    }
+    cases.push_back({"countUp", InterpStage, countUpProgram, 1.0, interpNesting});
+    cases.push_back({"countUp", StepStage, countUpProgram, 1.0, 0});
+    return cases;
+}
+
+/**
+ * @return the fastest of a few runs of `stage` on `source`, in nanoseconds.
+ */
+static double timeStage(stageT stage, const std::string &source) {
+    PTR(Expression) parsed = parseSource(source);
+    double best = -1;
+    double total = 0;
+    for (int run = 0; run < 5 && (run < 2 || total < 50e6); run++) {
+        auto begin = std::chrono::steady_clock::now();
+        switch (stage) {
+            case ParseStage:
+                parseSource(source);
+                break;
+            case OptimizeStage:
+                parsed->optimize();
+                break;
+            case PrintStage:
+                parsed->toString();
+                break;
+            case InterpStage:
+                parsed->interpret(Environment::empty());
+                break;
+            case StepStage:
+                Step::interpBySteps(parsed);
+                break;
+        }
+        auto end = std::chrono::steady_clock::now();
+        double nanos = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+        best = best < 0 ? nanos : std::min(best, nanos);
+        total += nanos;
+        if (nanos > maxRunNanos)
+            break;
+    }
+    return best;
+}
+
+/**
+ * @return the least-squares slope of log(time) against log(size).
+ */
+static double fitExponent(const std::vector<std::pair<int, double>> &points) {
+    double n = (double) points.size();
+    double sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+    for (const auto &point : points) {
+        double x = std::log((double) point.first);
+        double y = std::log(point.second);
+        sumX += x;
+        sumY += y;
+        sumXX += x * x;
+        sumXY += x * y;
+    }
+    return (n * sumXY - sumX * sumY) / (n * sumXX - sumX * sumX);
+}
+
+int scalingMain(int argc, char **argv) {
+    int maxSize = 1000000;
+    std::string only;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-max-size") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 10) {
+            maxSize = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-only") == 0 && i + 1 < argc) {
+            only = argv[++i];
+        } else {
+            std::cerr << "usage: benchmark -scaling [-max-size n] [-only stage]" << std::endl;
+            return 1;
+        }
+    }
+
+    int failures = 0;
+    std::cout << "family stage sizes fitted_exponent declared_exponent result" << std::endl;
+    for (const ScalingCase &scaling : scalingCases()) {
+        if (!only.empty() && only != stageNames[scaling.stage])
+            continue;
+        int limit = scaling.maxSize > 0 ? std::min(maxSize, scaling.maxSize) : maxSize;
+        std::vector<std::pair<int, double>> points;
+        std::string sizes;
+        try {
+            /* three sizes per decade: 10, 20, 50, 100, ... */
+            for (int decade = 10; decade <= limit; decade *= 10) {
+                bool slow = false;
+                for (int step : {1, 2, 5}) {
+                    int size = decade * step;
+                    if (size > limit)
+                        break;
+                    double nanos = timeStage(scaling.stage, scaling.program(size));
+                    if (nanos >= noiseFloorNanos) {
+                        points.emplace_back(size, nanos);
+                        sizes += (sizes.empty() ? "" : ",") + std::to_string(size);
+                    }
+                    if (nanos > maxRunNanos) {
+                        slow = true;
+                        break;
+                    }
+                }
+                if (slow || decade > limit / 10)
+                    break;
+            }
+        } catch (std::runtime_error &exn) {
+            std::cout << scaling.family << " " << stageNames[scaling.stage] << " - - "
+                      << scaling.declared << " error: " << exn.what() << std::endl;
+            failures++;
+            continue;
+        }
+
+        if (points.size() < 3) {
+            std::cout << scaling.family << " " << stageNames[scaling.stage] << " " << (sizes.empty() ? "-" : sizes)
+                      << " - " << scaling.declared << " too_fast_to_fit" << std::endl;
+            continue;
+        }
+        double exponent = fitExponent(points);
+        bool failed = exponent > scaling.declared + tolerance;
+        failures += failed;
+        std::cout << scaling.family << " " << stageNames[scaling.stage] << " " << sizes << " "
+                  << std::round(exponent * 100) / 100 << " " << scaling.declared << " "
+                  << (failed ? "FAIL" : "ok") << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
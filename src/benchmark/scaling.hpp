@@ -0,0 +1,17 @@
+#pragma once
+
+/**
+ * Runs `benchmark -scaling [-max-size n] [-only stage]`: times each
+ * pipeline stage on inputs growing from 10 up to `n` (10^6 by
+ * default), fits the exponent `k` of time ~ size^k by least squares on
+ * a log-log scale, and fails any stage whose exponent is more than
+ * `tolerance` above the complexity declared for it.
+ *
+ * A stage stops growing once one run takes longer than a second, and
+ * stages that recurse on the native stack stop at a size known to fit
+ * on it. Sizes whose runs take under 20 microseconds are too noisy to
+ * fit and are left out.
+ *
+ * @return 0 if every stage grows no faster than declared, 1 otherwise.
+ */
+extern int scalingMain(int argc, char **argv);
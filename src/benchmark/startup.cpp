@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "startup.hpp"
+#include "../testHarness/execute.hpp"
+
+static double percentile(std::vector<double> values, double fraction) {
+    std::sort(values.begin(), values.end());
+    return values[(size_t) (fraction * (double) (values.size() - 1))];
+}
+
+/**
+ * Runs `command` on `input` once and returns its wall time in
+ * microseconds, or throws if it does not print `expected`.
+ */
+static double timeRun(const char *const *command, const std::string &input, const std::string &expected,
+                      std::vector<double> *cpuMicros, long *maxRssKb) {
+    auto begin = std::chrono::steady_clock::now();
+    ExecResult result = execProgram(command, input, 10000);
+    auto end = std::chrono::steady_clock::now();
+    if (result.exitCode != 0 || result.out != expected)
+        throw std::runtime_error(std::string(command[0]) + " printed " + result.out + result.err + "for "
+                                 + input.substr(0, input.size() - 1) + ", exiting with "
+                                 + std::to_string(result.exitCode));
+    if (cpuMicros != nullptr)
+        cpuMicros->push_back((result.userSeconds + result.systemSeconds) * 1e6);
+    if (maxRssKb != nullptr)
+        *maxRssKb = std::max(*maxRssKb, result.maxRssKb);
+    return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / 1000;
+}
+
+int startupMain(int argc, char **argv) {
+    if (argc < 3) {
+        std::cerr << "usage: benchmark -startup path/to/main [-runs n] [-budget us] [-floor path]" << std::endl;
+        return 1;
+    }
+    const char *const command[] = {argv[2], "-interp", nullptr};
+    const char *floorCommand[] = {"/bin/cat", nullptr};
+    int runs = 200;
+    double budgetMicros = 300;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "-runs") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            runs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-budget") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0) {
+            budgetMicros = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-floor") == 0 && i + 1 < argc) {
+            floorCommand[0] = argv[++i];
+        } else {
+            std::cerr << "bad startup flag " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<double> wallMicros;
+    std::vector<double> floorMicros;
+    std::vector<double> cpuMicros;
+    long maxRssKb = 0;
+    try {
+        /* one untimed run of each so both binaries are in the page cache */
+        timeRun(command, "1+1\n", "2\n", nullptr, nullptr);
+        timeRun(floorCommand, "1+1\n", "1+1\n", nullptr, nullptr);
+        /* alternate them so a change in machine load shifts both alike */
+        for (int i = 0; i < runs; i++) {
+            wallMicros.push_back(timeRun(command, "1+1\n", "2\n", &cpuMicros, &maxRssKb));
+            floorMicros.push_back(timeRun(floorCommand, "1+1\n", "1+1\n", nullptr, nullptr));
+        }
+    } catch (std::runtime_error &exn) {
+        std::cerr << exn.what() << std::endl;
+        return 1;
+    }
+
+    double median = percentile(wallMicros, 0.5);
+    double floorMedian = percentile(floorMicros, 0.5);
+    double overhead = median - floorMedian;
+    std::cout << "runs " << runs << "\n"
+              << "median_us " << (long) median << "\n"
+              << "p90_us " << (long) percentile(wallMicros, 0.9) << "\n"
+              << "min_us " << (long) percentile(wallMicros, 0) << "\n"
+              << "median_cpu_us " << (long) percentile(cpuMicros, 0.5) << "\n"
+              << "max_rss_kb " << maxRssKb << "\n"
+              << "floor_median_us " << (long) floorMedian << "\n"
+              << "overhead_us " << (long) overhead << "\n"
+              << "budget_us " << (long) budgetMicros << " " << (overhead <= budgetMicros ? "ok" : "OVER") << std::endl;
+    return overhead <= budgetMicros ? 0 : 1;
+}
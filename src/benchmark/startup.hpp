@@ -0,0 +1,22 @@
+#pragma once
+
+/**
+ * Runs `benchmark -startup path/to/main [-runs n] [-budget us] [-floor path]`:
+ * starts `main -interp` on `1+1` `n` times (200 by default), one run
+ * after another, and prints the median, 90th percentile and minimum
+ * wall time from spawning it to its exit, with its median CPU time and
+ * peak memory. Between runs of `main` it runs the floor program
+ * (`/bin/cat` by default) on the same input, which costs only process
+ * creation and loading a small C binary.
+ *
+ * Fails if `main`'s median is more than `us` microseconds (300 by
+ * default) over the floor's, so a change that slows every invocation,
+ * such as heavier static initialization, is caught even though no
+ * workload measures it, while a slower machine moves both medians
+ * alike. On a one-CPU Linux VM `main` as the `main` target links it,
+ * with libstdc++ static, takes about 170 us over `/bin/cat`; linked
+ * against a shared libstdc++ it takes about 700 us over.
+ *
+ * @return 0 if the overhead is within the budget, 1 otherwise.
+ */
+extern int startupMain(int argc, char **argv);
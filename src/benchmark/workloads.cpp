@@ -0,0 +1,87 @@
+#include <string>
+#include <utility>
+#include "workloads.hpp"
+
+Workload::Workload(std::string name, std::string source, std::string expected) {
+    this->name = std::move(name);
+    this->source = std::move(source);
+    this->expected = std::move(expected);
+}
+
+std::string variableName(char prefix, long i) {
+    std::string name(1, prefix);
+    do {
+        name += (char) ('a' + i % 26);
+        i /= 26;
+    } while (i > 0);
+    return name;
+}
+
+std::vector<Workload> canonicalWorkloads() {
+    std::vector<Workload> workloads;
+    workloads.emplace_back("fib", fibProgram(18), "2584");
+    workloads.emplace_back("factorial", factorialProgram(300), "300");
+    workloads.emplace_back("countDown", countDownProgram(5000), "0");
+    workloads.emplace_back("countUp", countUpProgram(5000), "5000");
+    workloads.emplace_back("letNest", letNestProgram(500), "500");
+    workloads.emplace_back("addChain", addChainProgram(5000), "5000");
+    workloads.emplace_back("curriedCall", curriedCallProgram(500), "500");
+    return workloads;
+}
+
+std::string fibProgram(int n) {
+    return "_let fib = _fun (fib) _fun (n)\n"
+           "  _if n == 0 _then 0\n"
+           "  _else _if n == 1 _then 1\n"
+           "  _else fib(fib)(n + -1) + fib(fib)(n + -2)\n"
+           "_in fib(fib)(" + std::to_string(n) + ")";
+}
+
+std::string factorialProgram(int times) {
+    return "_let factorial = _fun (factorial) _fun (x)\n"
+           "  _if x == 1 _then 1 _else x * factorial(factorial)(x + -1)\n"
+           "_in _let loop = _fun (loop) _fun (n)\n"
+           "  _if n == 0 _then 0\n"
+           "  _else (_if factorial(factorial)(12) == 479001600 _then 1 _else 0) + loop(loop)(n + -1)\n"
+           "_in loop(loop)(" + std::to_string(times) + ")";
+}
+
+std::string countDownProgram(int n) {
+    return "_let countDown = _fun (countDown) _fun (n)\n"
+           "  _if n == 0 _then 0 _else countDown(countDown)(n + -1)\n"
+           "_in countDown(countDown)(" + std::to_string(n) + ")";
+}
+
+std::string countUpProgram(int n) {
+    return "_let countUp = _fun (countUp) _fun (n)\n"
+           "  _if n == 0 _then 0 _else 1 + countUp(countUp)(n + -1)\n"
+           "_in countUp(countUp)(" + std::to_string(n) + ")";
+}
+
+std::string letNestProgram(int depth) {
+    std::string source = "_let " + variableName('x', 0) + " = 1\n";
+    for (int i = 1; i < depth; i++)
+        source += "_in _let " + variableName('x', i) + " = " + variableName('x', i - 1) + " + 1\n";
+    return source + "_in " + variableName('x', depth - 1);
+}
+
+std::string addChainProgram(int terms) {
+    std::string source = "1";
+    for (int i = 1; i < terms; i++)
+        source += " + 1";
+    return source;
+}
+
+std::string curriedCallProgram(int width) {
+    std::string function;
+    std::string body = variableName('a', 0);
+    for (int i = 0; i < width; i++) {
+        function += "_fun (" + variableName('a', i) + ") ";
+        if (i > 0)
+            body += " + " + variableName('a', i);
+    }
+    std::string source = "_let f = " + function + body + "\n_in f";
+    for (int i = 0; i < width; i++)
+        source += "(1)";
+    return source;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * One MSDScript program the benchmarks time, with the result that
+ * interpreting it must print.
+ */
+class Workload {
+public:
+    std::string name;
+    std::string source;
+    std::string expected;
+
+    Workload(std::string name, std::string source, std::string expected);
+};
+
+/**
+ * @return the workloads `benchmark` times by default, each sized to
+ * take a few milliseconds to interpret.
+ */
+extern std::vector<Workload> canonicalWorkloads();
+
+/**
+ * Doubly recursive Fibonacci of `n`, with fib(0) = 0 and fib(1) = 1.
+ */
+extern std::string fibProgram(int n);
+
+/**
+ * Computes 12 factorial `times` times over, counting the right answers.
+ */
+extern std::string factorialProgram(int times);
+
+/**
+ * Recurses `n` times and returns 0 without adding anything.
+ */
+extern std::string countDownProgram(int n);
+
+/**
+ * Recurses `n` times, adding 1 on the way back up.
+ */
+extern std::string countUpProgram(int n);
+
+/**
+ * `depth` nested `_let`s, each binding one more than the last.
+ */
+extern std::string letNestProgram(int depth);
+
+/**
+ * `1 + 1 + ... + 1` with `terms` terms.
+ */
+extern std::string addChainProgram(int terms);
+
+/**
+ * A function of `width` curried arguments applied to all of them.
+ */
+extern std::string curriedCallProgram(int width);
+
+/**
+ * @return a distinct variable name starting with `prefix` for each
+ * `i`, since MSDScript names are letters only.
+ */
+extern std::string variableName(char prefix, long i);
@@ -1,13 +1,22 @@
+#include <algorithm>
 #include <string>
-#include <cassert>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
 
 #include <unistd.h>
 #include <fcntl.h>
 #include <poll.h>
 #include <errno.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
 
 #include "execute.hpp"
 
+extern char **environ;
+
 static const int READ_END = 0;
 static const int WRITE_END = 1;
 
@@ -15,94 +24,129 @@ static const int STDIN_FD = 0;
 static const int STDOUT_FD = 1;
 static const int STDERR_FD = 2;
 
-static void nonblocking(int fd, bool enabled);
+// A whole pipe buffer on Linux, so one read usually drains it
+static const size_t READ_SIZE = 64 * 1024;
+
+static void makePipe(int fds[2]);
+
+static void nonblocking(int fd);
 
 static int needsRetry(int rtn);
 
-static void waitUntilOneReady(int wrFd, bool wrDone,
+static bool waitUntilOneReady(int wrFd, bool wrDone,
                               int rd1Fd, bool rd1Done,
-                              int rd2Fd, bool rd2Done);
+                              int rd2Fd, bool rd2Done,
+                              int timeoutMillis);
 
-static void pumpTo(std::string &str, int fd, bool &done);
+static void pumpTo(std::string &str, size_t &written, int fd, bool &done);
 
 static void pumpFrom(int fd, std::string &str, bool &done);
 
-static void waitChild(pid_t pid, int &exitCode);
+static void waitChild(pid_t pid, ExecResult &r, int timeoutMillis,
+                      std::chrono::steady_clock::time_point deadline);
 
 // Run the program in command[0], where `command` must be a NULL-terminated
 // array (like `execv` expects). Supply the given string as stdin to the
 // program, wait until it complete, and report its exit status, stdout
 // as a string, and stderr s a string. The exit status is set to a signal
 // number if the program exits with a signal.
-ExecResult execProgram(const char *const *command, std::string input) {
+//
+// The program is started with `posix_spawn`, which avoids copying the
+// page tables of a large parent the way `fork` does. If `timeoutMillis`
+// is not negative and the program runs longer, it is killed and
+// `timedOut` is set. The program's CPU time and peak memory are always
+// reported.
+ExecResult execProgram(const char *const *command, std::string input, int timeoutMillis) {
     signal(SIGPIPE, SIG_IGN);
 
     int in[2];
-    if (pipe(in) != 0)
-        throw std::runtime_error("stdin pipe failed");
-
     int out[2];
-    if (pipe(out) != 0)
-        throw std::runtime_error("stdout pipe failed");
-
     int err[2];
-    if (pipe(err) != 0)
-        throw std::runtime_error("stdout pipe failed");
-
-    pid_t pid = fork();
-    if (pid == -1)
-        throw std::runtime_error("fork failed");
-    else if (pid == 0) {
-        /* child */
-        dup2(in[READ_END], STDIN_FD);
-        dup2(out[WRITE_END], STDOUT_FD);
-        dup2(err[WRITE_END], STDERR_FD);
-
-        close(in[READ_END]);
+    makePipe(in);
+    makePipe(out);
+    makePipe(err);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, in[READ_END], STDIN_FD);
+    posix_spawn_file_actions_adddup2(&actions, out[WRITE_END], STDOUT_FD);
+    posix_spawn_file_actions_adddup2(&actions, err[WRITE_END], STDERR_FD);
+
+    pid_t pid;
+    int spawnError = posix_spawn(&pid, command[0], &actions, nullptr, (char *const *) command, environ);
+    posix_spawn_file_actions_destroy(&actions);
+
+    close(in[READ_END]);
+    close(out[WRITE_END]);
+    close(err[WRITE_END]);
+    if (spawnError != 0) {
         close(in[WRITE_END]);
         close(out[READ_END]);
-        close(out[WRITE_END]);
         close(err[READ_END]);
-        close(err[WRITE_END]);
+        throw std::runtime_error(std::string("spawn failed: ") + strerror(spawnError));
+    }
 
-        execv(command[0], (char *const *) command);
+    // only the parent's ends are non-blocking; the child sees ordinary pipes
+    nonblocking(in[WRITE_END]);
+    nonblocking(out[READ_END]);
+    nonblocking(err[READ_END]);
 
-        /* Getting here means that the execve failed */
-        {
-            const char *msg = "exec failed";
-            write(STDERR_FD, msg, strlen(msg));
-            exit(1);
-        }
-    } else {
-        /* parent */
-        bool inDone = false, outDone = false, errDone = false;
-        ExecResult r;
+    bool inDone = false, outDone = false, errDone = false;
+    size_t written = 0;
+    ExecResult r;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMillis);
 
-        close(in[READ_END]);
-        close(out[WRITE_END]);
-        close(err[WRITE_END]);
+    do {
+        int waitMillis = -1;
+        if (timeoutMillis >= 0) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - std::chrono::steady_clock::now()).count();
+            waitMillis = left > 0 ? (int) left : 0;
+        }
+        if (!waitUntilOneReady(in[WRITE_END], inDone,
+                               out[READ_END], outDone,
+                               err[READ_END], errDone,
+                               waitMillis)) {
+            kill(pid, SIGKILL);
+            r.timedOut = true;
+            if (!inDone)
+                close(in[WRITE_END]);
+            if (!outDone)
+                close(out[READ_END]);
+            if (!errDone)
+                close(err[READ_END]);
+            break;
+        }
+        pumpTo(input, written, in[WRITE_END], inDone);
+        pumpFrom(out[READ_END], r.out, outDone);
+        pumpFrom(err[READ_END], r.err, errDone);
+    } while (!inDone || !outDone || !errDone);
 
-        do {
-            waitUntilOneReady(in[WRITE_END], inDone,
-                              out[READ_END], outDone,
-                              err[READ_END], errDone);
-            pumpTo(input, in[WRITE_END], inDone);
-            pumpFrom(out[READ_END], r.out, outDone);
-            pumpFrom(err[READ_END], r.err, errDone);
-        } while (!inDone || !outDone || !errDone);
+    waitChild(pid, r, r.timedOut ? -1 : timeoutMillis, deadline);
 
-        waitChild(pid, r.exitCode);
+    return r;
+}
 
-        return r;
-    }
+// Make a pipe whose ends are not inherited by programs spawned later,
+// so a program sees EOF on stdin when its own writer closes. Linux sets
+// the flag atomically, so another thread spawning at the same moment
+// cannot inherit the pipe either.
+static void makePipe(int fds[2]) {
+#ifdef __linux__
+    if (pipe2(fds, O_CLOEXEC) != 0)
+        throw std::runtime_error("pipe failed");
+#else
+    if (pipe(fds) != 0)
+        throw std::runtime_error("pipe failed");
+    fcntl(fds[READ_END], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[WRITE_END], F_SETFD, FD_CLOEXEC);
+#endif
 }
 
-// Enable/disable nonblocking mode for a file descriptor
-static void nonblocking(int fd, bool enabled) {
+// Enable nonblocking mode for a file descriptor
+static void nonblocking(int fd) {
     int oldFlags = fcntl(fd, F_GETFL, 0);
-    fcntl(fd, F_SETFL, (enabled
-                        ? oldFlags | O_NONBLOCK
-                        : oldFlags - (oldFlags & O_NONBLOCK)));
+    fcntl(fd, F_SETFL, oldFlags | O_NONBLOCK);
 }
 
 // Check whether a system call result means "retry"
@@ -110,11 +154,13 @@ static int needsRetry(int rtn) {
     return (rtn == -1) && (errno == EINTR);
 }
 
-// Block until reading or writing is possible on one of the
-// given file descriptors
-static void waitUntilOneReady(int wrFd, bool wrDone,
+// Block until reading or writing is possible on one of the given file
+// descriptors, or for at most `timeoutMillis` if it is not negative.
+// Returns false if the time ran out first.
+static bool waitUntilOneReady(int wrFd, bool wrDone,
                               int rd1Fd, bool rd1Done,
-                              int rd2Fd, bool rd2Done) {
+                              int rd2Fd, bool rd2Done,
+                              int timeoutMillis) {
     struct pollfd pollInfo[3];
     int count = 0;
 
@@ -132,87 +178,113 @@ static void waitUntilOneReady(int wrFd, bool wrDone,
     }
 
     if (count == 0)
-        return;
+        return true;
 
     int rtn;
     do {
-        rtn = poll(pollInfo, static_cast<nfds_t>(count), -1);
+        rtn = poll(pollInfo, static_cast<nfds_t>(count), timeoutMillis);
     } while (needsRetry(rtn));
 
     if (rtn == -1)
         throw std::runtime_error("poll failed");
+    return rtn > 0;
 }
 
-// Move characters from the given string to the given file descriptor,
-// closing the file descriptor if the string is empty. The `done` flag
-// is consulted and possibly set to indicate whether the file descriptor
-// is still open.
-static void pumpTo(std::string &str, int fd, bool &done) {
-    if (!done) {
+// Move characters from the given string, starting at `written`, to the
+// given file descriptor until it would block, closing the file
+// descriptor once all are written. The `done` flag is consulted and
+// possibly set to indicate whether the file descriptor is still open.
+static void pumpTo(std::string &str, size_t &written, int fd, bool &done) {
+    while (!done) {
+        if (written == str.length()) {
+            done = true;
+            close(fd);
+            return;
+        }
         ssize_t len;
-        nonblocking(fd, true);
         do {
-            len = write(fd, str.c_str(), str.length());
+            len = write(fd, str.data() + written, str.length() - written);
         } while (needsRetry((int) len));
-        nonblocking(fd, false);
         if ((len < 0) && (errno == EAGAIN)) {
-            // not ready to write
-        } else {
-            if (len < 0)
-                str.erase(0, str.length()); // treat error like writing all
-            else
-                str.erase(0, static_cast<unsigned long>(len));
-            if (str.length() == 0) {
-                done = true;
-                close(fd);
-            }
+            return; // not ready to write
         }
+        if (len < 0)
+            written = str.length(); // treat error like writing all
+        else
+            written += static_cast<size_t>(len);
     }
 }
 
 // Move characters from the given file descriptor to the given string
-// closing the file descriptor on EOF. The `done` flag is consulted
-// and possibly set to indicate whether the file descriptor is still
-// open.
+// until it would block, closing the file descriptor on EOF. The `done`
+// flag is consulted and possibly set to indicate whether the file
+// descriptor is still open.
 static void pumpFrom(int fd, std::string &str, bool &done) {
-    if (!done) {
-        char buffer[256];
+    char buffer[READ_SIZE];
+    while (!done) {
         ssize_t len;
-        nonblocking(fd, true);
         do {
-            len = read(fd, buffer, sizeof(buffer) - 1);
+            len = read(fd, buffer, sizeof(buffer));
         } while (needsRetry((int) len));
-        nonblocking(fd, false);
         if ((len < 0) && (errno == EAGAIN)) {
-            // nothing ready to read
+            return; // nothing ready to read
+        }
+        if (len < 1) {
+            // error or EOF
+            done = true;
+            close(fd);
         } else {
-            if (len < 1) {
-                // error or EOF
-                done = true;
-                close(fd);
-            } else {
-                ssize_t oldLen = str.length();
-                str.insert(static_cast<unsigned long>(oldLen), buffer, static_cast<unsigned long>(len));
-                assert(str.length() == oldLen + len);
-            }
+            str.append(buffer, static_cast<size_t>(len));
         }
     }
 }
 
-// Wait until a process has terminated
-static void waitChild(pid_t pid, int &exitCode) {
+// Wait until a process has terminated, recording how it ended and the
+// resources it used. A program can close its output and keep running,
+// so if `timeoutMillis` is not negative the wait polls and kills the
+// program once `deadline` passes. The polls start a few microseconds
+// apart, since a program usually exits right after closing its output,
+// and back off to a millisecond.
+static void waitChild(pid_t pid, ExecResult &r, int timeoutMillis,
+                      std::chrono::steady_clock::time_point deadline) {
     int status;
+    struct rusage usage;
     pid_t rtn;
 
-    do {
-        rtn = waitpid(pid, &status, 0);
-    } while (needsRetry(rtn));
+    if (timeoutMillis >= 0) {
+        useconds_t pause = 10;
+        do {
+            rtn = wait4(pid, &status, WNOHANG, &usage);
+            if (rtn == 0) {
+                if (std::chrono::steady_clock::now() >= deadline) {
+                    kill(pid, SIGKILL);
+                    r.timedOut = true;
+                    break;
+                }
+                usleep(pause);
+                pause = std::min(pause * 2, (useconds_t) 1000);
+            }
+        } while (rtn == 0 || needsRetry(rtn));
+    }
+    if (timeoutMillis < 0 || r.timedOut) {
+        do {
+            rtn = wait4(pid, &status, 0, &usage);
+        } while (needsRetry(rtn));
+    }
     if (rtn == -1)
         throw std::runtime_error("waitpid failed");
     if (WIFEXITED(status))
-        exitCode = WEXITSTATUS(status);
+        r.exitCode = WEXITSTATUS(status);
     else if (WIFSIGNALED(status))
-        exitCode = WTERMSIG(status);
+        r.exitCode = WTERMSIG(status);
     else
         throw std::runtime_error("unrecognized status from waitpid");
+
+    r.userSeconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+    r.systemSeconds = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+#ifdef __APPLE__
+    r.maxRssKb = usage.ru_maxrss / 1024; // bytes on macOS
+#else
+    r.maxRssKb = usage.ru_maxrss;
+#endif
 }
@@ -7,13 +7,23 @@ public:
     int exitCode;
     std::string out;
     std::string err;
+    bool timedOut;        // the program was killed for running past its timeout
+    double userSeconds;   // CPU time the program spent in user mode
+    double systemSeconds; // CPU time the kernel spent on the program's behalf
+    long maxRssKb;        // an upper bound on the program's peak resident set size:
+                          // Linux counts the spawning process's own from before
+                          // the exec, too
 
     ExecResult() {
         exitCode = 0;
         out = "";
         err = "";
+        timedOut = false;
+        userSeconds = 0;
+        systemSeconds = 0;
+        maxRssKb = 0;
     }
 };
 
-extern ExecResult execProgram(const char *const *command, std::string input);
+extern ExecResult execProgram(const char *const *command, std::string input, int timeoutMillis = -1);
 
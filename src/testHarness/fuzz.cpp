@@ -0,0 +1,242 @@
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include "fuzz.hpp"
+#include "../benchmark/generator.hpp"
+#include "../ArithmeticParser/expression.hpp"
+#include "../ArithmeticParser/Environment.h"
+#include "../ArithmeticParser/value.h"
+#include "../ArithmeticParser/step.h"
+#include "../ArithmeticParser/budget.h"
+#include "../ArithmeticParser/parse.h"
+#include "../catch/catch.hpp"
+
+bool Fuzzer::Outcome::disagrees() const {
+    return !aborted && pattern() != 0;
+}
+
+int Fuzzer::Outcome::pattern() const {
+    return (step != interp ? 1 : 0) | (optimized != interp ? 2 : 0);
+}
+
+typedef enum {
+    InterpEngine,
+    StepEngine,
+    OptimizedEngine
+} engineT;
+
+/**
+ * @return the printed result of evaluating `program` with `engine`, or
+ * `error`; sets `aborted` if the evaluation ran out of fuel.
+ */
+static std::string run(engineT engine, const PTR(Expression) &program, bool &aborted) {
+    Budget budget(Fuzzer::fuel, std::chrono::milliseconds(0));
+    Budget::Scope scope(&budget);
+    try {
+        switch (engine) {
+            case InterpEngine:
+                return program->interpret(Environment::empty())->toString();
+            case StepEngine:
+                return Step::interpBySteps(program)->toString();
+            case OptimizedEngine:
+                return program->optimize()->interpret(Environment::empty())->toString();
+        }
+    } catch (EvaluationAborted &exn) {
+        aborted = true;
+    } catch (std::runtime_error &exn) {
+    }
+    return "error";
+}
+
+Fuzzer::Outcome Fuzzer::evaluate(const PTR(Expression) &program) {
+    Outcome outcome;
+    outcome.aborted = false;
+    outcome.interp = run(InterpEngine, program, outcome.aborted);
+    outcome.step = run(StepEngine, program, outcome.aborted);
+    outcome.optimized = run(OptimizedEngine, program, outcome.aborted);
+    return outcome;
+}
+
+std::vector<PTR(Expression)> Fuzzer::children(const PTR(Expression) &e) {
+    if (PTR(AddExpression) add = CAST(AddExpression)(e))
+        return {add->leftExpression, add->rightExpression};
+    if (PTR(MultiplyExpression) multiply = CAST(MultiplyExpression)(e))
+        return {multiply->leftExpression, multiply->rightExpression};
+    if (PTR(EqualsExpression) equals = CAST(EqualsExpression)(e))
+        return {equals->leftExpression, equals->rightExpression};
+    if (PTR(LetExpression) let = CAST(LetExpression)(e))
+        return {let->rhs, let->body};
+    if (PTR(IfExpression) ifExpression = CAST(IfExpression)(e))
+        return {ifExpression->testPart, ifExpression->thenResult, ifExpression->elseResult};
+    if (PTR(FunctionExpression) function = CAST(FunctionExpression)(e))
+        return {function->body};
+    if (PTR(CallExpression) call = CAST(CallExpression)(e))
+        return {call->toBeCalled, call->actualArg};
+    return {};
+}
+
+PTR(Expression) Fuzzer::withChild(const PTR(Expression) &e, size_t i, PTR(Expression) child) {
+    std::vector<PTR(Expression)> kids = children(e);
+    kids[i] = std::move(child);
+    if (CAST(AddExpression)(e))
+        return NEW(AddExpression)(kids[0], kids[1]);
+    if (CAST(MultiplyExpression)(e))
+        return NEW(MultiplyExpression)(kids[0], kids[1]);
+    if (CAST(EqualsExpression)(e))
+        return NEW(EqualsExpression)(kids[0], kids[1]);
+    if (PTR(LetExpression) let = CAST(LetExpression)(e))
+        return NEW(LetExpression)(let->var, kids[0], kids[1]);
+    if (CAST(IfExpression)(e))
+        return NEW(IfExpression)(kids[0], kids[1], kids[2]);
+    if (PTR(FunctionExpression) function = CAST(FunctionExpression)(e))
+        return NEW(FunctionExpression)(function->formalArg, kids[0]);
+    return NEW(CallExpression)(kids[0], kids[1]);
+}
+
+/**
+ * Adds every program one replacement smaller than `e` to `out`,
+ * replacements nearer the root first.
+ */
+void Fuzzer::candidates(const PTR(Expression) &e, std::vector<PTR(Expression)> &out) {
+    std::vector<PTR(Expression)> kids = children(e);
+    for (const PTR(Expression) &kid : kids)
+        out.push_back(kid);
+    PTR(NumberExpression) number = CAST(NumberExpression)(e);
+    if (number == nullptr || number->primitiveValue != 0)
+        out.push_back(NEW(NumberExpression)(0));
+    for (size_t i = 0; i < kids.size(); i++) {
+        std::vector<PTR(Expression)> smaller;
+        candidates(kids[i], smaller);
+        for (PTR(Expression) &kid : smaller)
+            out.push_back(withChild(e, i, std::move(kid)));
+    }
+}
+
+PTR(Expression) Fuzzer::shrink(PTR(Expression) program, long maxTries) {
+    int pattern = evaluate(program).pattern();
+    long tries = 0;
+    bool shrunk = true;
+    while (shrunk && tries < maxTries) {
+        shrunk = false;
+        std::vector<PTR(Expression)> smaller;
+        candidates(program, smaller);
+        for (const PTR(Expression) &candidate : smaller) {
+            if (tries++ >= maxTries)
+                break;
+            Outcome outcome = evaluate(candidate);
+            if (outcome.disagrees() && outcome.pattern() == pattern) {
+                program = candidate;
+                shrunk = true;
+                break;
+            }
+        }
+    }
+    return program;
+}
+
+std::string Fuzzer::source(const PTR(Expression) &program) {
+    if (PTR(NumberExpression) number = CAST(NumberExpression)(program))
+        return std::to_string(number->primitiveValue);
+    if (PTR(BooleanExpression) boolean = CAST(BooleanExpression)(program))
+        return boolean->truthValue ? "_true" : "_false";
+    if (PTR(VariableExpression) variable = CAST(VariableExpression)(program))
+        return variable->name;
+    if (PTR(AddExpression) add = CAST(AddExpression)(program))
+        return "(" + source(add->leftExpression) + " + " + source(add->rightExpression) + ")";
+    if (PTR(MultiplyExpression) multiply = CAST(MultiplyExpression)(program))
+        return "(" + source(multiply->leftExpression) + " * " + source(multiply->rightExpression) + ")";
+    if (PTR(EqualsExpression) equals = CAST(EqualsExpression)(program))
+        return "(" + source(equals->leftExpression) + " == " + source(equals->rightExpression) + ")";
+    if (PTR(LetExpression) let = CAST(LetExpression)(program))
+        return "(_let " + let->var + " = " + source(let->rhs) + " _in " + source(let->body) + ")";
+    if (PTR(IfExpression) ifExpression = CAST(IfExpression)(program))
+        return "(_if " + source(ifExpression->testPart) + " _then " + source(ifExpression->thenResult)
+               + " _else " + source(ifExpression->elseResult) + ")";
+    if (PTR(FunctionExpression) function = CAST(FunctionExpression)(program))
+        return "(_fun (" + function->formalArg + ") " + source(function->body) + ")";
+    PTR(CallExpression) call = CAST(CallExpression)(program);
+    if (call == nullptr)
+        throw std::runtime_error("unknown expression " + program->toString());
+    std::string callee = source(call->toBeCalled);
+    if (CAST(NumberExpression)(call->toBeCalled) || CAST(BooleanExpression)(call->toBeCalled))
+        callee = "(" + callee + ")";
+    return callee + "(" + source(call->actualArg) + ")";
+}
+
+std::string Fuzzer::program(uint64_t seed, uint64_t index) {
+    /* each case's options come from its index */
+    uint64_t bits = splitmix64(seed ^ splitmix64(index));
+    GeneratorOptions options;
+    options.seed = bits;
+    bits = splitmix64(bits);
+    options.depth = 1 + (int) (bits % 8);
+    options.letDensity = (double) ((bits >> 8) % 50) / 100;
+    options.callDensity = (double) ((bits >> 16) % 40) / 100;
+    switch ((bits >> 24) % 8) {
+        case 0:
+        case 1:
+            options.recursion = GeneratorOptions::LinearRecursion;
+            options.recursionDepth = (int) ((bits >> 32) % 40);
+            break;
+        case 2:
+            options.recursion = GeneratorOptions::TreeRecursion;
+            options.recursionDepth = (int) ((bits >> 32) % 10);
+            break;
+        default:
+            options.recursion = GeneratorOptions::NoRecursion;
+    }
+    return ProgramGenerator(options).program();
+}
+
+TEST_CASE("Fuzzer::source round-trips") {
+    for (const char *text : {"1", "-3", "x", "_true", "1 + 2 * 3", "(1 + 2) * 3", "1 + (2 + 3)", "(1 * 2) * 3",
+                             "(_let x = 1 _in x) + 2", "_let x = -1 _in _let y = x _in x * y",
+                             "_if 1 == 2 _then _false _else _true == _true", "(1 == 2) == _false",
+                             "_fun (f) f(f)(-2)", "(_fun (x) x + 1)(2)", "(_if _true _then 1 _else 2)(3)"}) {
+        PTR(Expression) program = parseSource(text);
+        CHECK(parseSource(Fuzzer::source(program))->equals(program));
+    }
+    for (uint64_t i = 0; i < 200; i++) {
+        PTR(Expression) program = parseSource(Fuzzer::program(11, i));
+        CHECK(parseSource(Fuzzer::source(program))->equals(program));
+    }
+}
+
+TEST_CASE("Fuzzer::evaluate") {
+    Fuzzer::Outcome outcome = Fuzzer::evaluate(parseSource("_let f = _fun (x) x * 2 _in f(3) + 1"));
+    CHECK(outcome.interp == "7");
+    CHECK(outcome.step == "7");
+    CHECK(outcome.optimized == "7");
+    CHECK(!outcome.disagrees());
+
+    /* calling a number is an error every way, not a disagreement */
+    outcome = Fuzzer::evaluate(parseSource("(_if _true _then 1 _else 2)(3)"));
+    CHECK(outcome.interp == "error");
+    CHECK(outcome.step == "error");
+    CHECK(outcome.optimized == "error");
+    CHECK(!outcome.disagrees());
+
+    for (uint64_t i = 0; i < 100; i++)
+        CHECK(!Fuzzer::evaluate(parseSource(Fuzzer::program(3, i))).disagrees());
+}
+
+TEST_CASE("Fuzzer::shrink") {
+    /* the optimizer folds both arms of an `_if` with a constant test, so
+       only it trips over the ill-typed arm the others never reach */
+    PTR(Expression) program = parseSource("_let a = 3 _in (_if _true _then a * 2 _else (1 + _true)) + 4");
+    Fuzzer::Outcome outcome = Fuzzer::evaluate(program);
+    REQUIRE(outcome.disagrees());
+    CHECK(outcome.interp == "10");
+    CHECK(outcome.optimized == "error");
+    CHECK(outcome.pattern() == 2);
+
+    PTR(Expression) shrunk = Fuzzer::shrink(program);
+    CHECK(Fuzzer::source(shrunk) == "(_if _true _then 0 _else (0 + _true))");
+    CHECK(Fuzzer::evaluate(shrunk).pattern() == 2);
+    CHECK(Fuzzer::source(Fuzzer::shrink(parseSource("_if _true _then 1 _else (1 + _true)"))) ==
+          Fuzzer::source(shrunk));
+
+    /* a program the evaluations agree on stays as it is */
+    PTR(Expression) agreed = parseSource("1 + 2");
+    CHECK(Fuzzer::shrink(agreed)->equals(agreed));
+}
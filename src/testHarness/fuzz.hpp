@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../ArithmeticParser/pointer.h"
+
+class Expression;
+
+/**
+ * Differential testing of the three ways to evaluate a program:
+ * `interpret`, `Step::interpBySteps` and `interpret` of `optimize`.
+ * Every program must give all three the same result, or make all
+ * three fail; which error each reports is not compared.
+ */
+class Fuzzer {
+public:
+    /**
+     * How each way of evaluating one program ended: the printed value,
+     * or `error`.
+     */
+    class Outcome {
+    public:
+        std::string interp;
+        std::string step;
+        std::string optimized;
+        bool aborted; /* some evaluation ran out of fuel, so nothing can be concluded */
+
+        /**
+         * @return whether the evaluations that finished disagree.
+         */
+        bool disagrees() const;
+
+        /**
+         * @return which evaluations disagree with `interp`, so shrinking
+         * can keep to the same disagreement.
+         */
+        int pattern() const;
+    };
+
+    /**
+     * Steps allowed to each evaluation, which also bounds how deep the
+     * recursive interpreter can nest on the native stack.
+     */
+    static const long fuel = 20000;
+
+    /**
+     * @return how `program` evaluates each way.
+     */
+    static Outcome evaluate(const PTR(Expression) &program);
+
+    /**
+     * @return the smallest program found by repeatedly replacing a
+     * subexpression of `program` with one of its own subexpressions or
+     * with 0 while the same evaluations still disagree, trying at most
+     * `maxTries` candidates.
+     */
+    static PTR(Expression) shrink(PTR(Expression) program, long maxTries = 100000);
+
+    /**
+     * @return `program` as source that parses back to it: unlike
+     * `toString`, every compound expression is parenthesized.
+     */
+    static std::string source(const PTR(Expression) &program);
+
+    /**
+     * @return the random well-typed program of case `index` of a run
+     * started with `seed`; each case varies the generator's options.
+     */
+    static std::string program(uint64_t seed, uint64_t index);
+
+private:
+    static std::vector<PTR(Expression)> children(const PTR(Expression) &e);
+
+    static PTR(Expression) withChild(const PTR(Expression) &e, size_t i, PTR(Expression) child);
+
+    static void candidates(const PTR(Expression) &e, std::vector<PTR(Expression)> &out);
+};
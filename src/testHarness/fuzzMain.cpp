@@ -0,0 +1,137 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "fuzz.hpp"
+#include "../ArithmeticParser/expression.hpp"
+#include "../ArithmeticParser/parse.h"
+
+/**
+ * fuzz [-seconds s] [-cases n] [-threads n] [-seed n]
+ *
+ * Generates random well-typed programs on every core and checks that
+ * `interpret`, `Step::interpBySteps` and `interpret` of `optimize`
+ * agree on each, until `s` seconds (60 by default) or `n` cases have
+ * passed. Prints the rate every few seconds on standard error.
+ *
+ * On the first disagreement, shrinks the program, prints the original
+ * and the shrunk program with each evaluation's result, and exits with
+ * 1. Case numbers and the seed reproduce a program exactly.
+ */
+
+class Options {
+public:
+    double seconds = 60;
+    long cases = -1;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    uint64_t seed = (uint64_t) time(nullptr);
+};
+
+/**
+ * The first disagreement any thread found.
+ */
+class Failure {
+public:
+    std::mutex lock;
+    bool found = false;
+    uint64_t index = 0;
+    std::string original;
+    PTR(Expression) shrunk;
+    Fuzzer::Outcome outcome;
+};
+
+static void fuzz(const Options &options, std::atomic<long> &next, std::atomic<long> &passed,
+                 std::atomic<bool> &stop, Failure &failure) {
+    while (!stop) {
+        long index = next++;
+        if (options.cases >= 0 && index >= options.cases)
+            return;
+        std::string source = Fuzzer::program(options.seed, (uint64_t) index);
+        PTR(Expression) program = parseSource(source);
+        if (!Fuzzer::evaluate(program).disagrees()) {
+            passed++;
+            continue;
+        }
+
+        stop = true;
+        PTR(Expression) shrunk = Fuzzer::shrink(program);
+        std::lock_guard<std::mutex> guard(failure.lock);
+        if (!failure.found || (uint64_t) index < failure.index) {
+            failure.found = true;
+            failure.index = (uint64_t) index;
+            failure.original = source;
+            failure.shrunk = shrunk;
+            failure.outcome = Fuzzer::evaluate(shrunk);
+        }
+        return;
+    }
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-seconds") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0) {
+            options.seconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-cases") == 0 && i + 1 < argc && atol(argv[i + 1]) >= 0) {
+            options.cases = atol(argv[++i]);
+            options.seconds = 1e9;
+        } else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            options.threads = (unsigned) atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+            options.seed = strtoull(argv[++i], nullptr, 10);
+        } else {
+            std::cerr << "usage: fuzz [-seconds s] [-cases n] [-threads n] [-seed n]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cerr << "fuzzing with seed " << options.seed << " on " << options.threads << " threads" << std::endl;
+    std::atomic<long> next(0);
+    std::atomic<long> passed(0);
+    std::atomic<bool> stop(false);
+    Failure failure;
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < options.threads; i++)
+        workers.emplace_back(fuzz, std::cref(options), std::ref(next), std::ref(passed), std::ref(stop),
+                             std::ref(failure));
+
+    auto started = std::chrono::steady_clock::now();
+    auto reported = started;
+    std::atomic<bool> done(false);
+    std::thread timer([&] {
+        while (!done) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            auto now = std::chrono::steady_clock::now();
+            double elapsed = std::chrono::duration<double>(now - started).count();
+            if (elapsed >= options.seconds)
+                stop = true;
+            if (now - reported >= std::chrono::seconds(5)) {
+                reported = now;
+                std::cerr << passed << " cases passed, " << (long) (passed / elapsed) << " per second" << std::endl;
+            }
+        }
+    });
+    for (std::thread &worker : workers)
+        worker.join();
+    done = true;
+    timer.join();
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    std::cerr << passed << " cases passed in " << elapsed << " s, " << (long) (passed / elapsed) << " per second"
+              << std::endl;
+    if (!failure.found)
+        return 0;
+
+    std::cout << "case " << failure.index << " of seed " << options.seed << " disagrees:\n"
+              << failure.original << "\n"
+              << "shrunk to:\n" << Fuzzer::source(failure.shrunk) << "\n"
+              << "interp: " << failure.outcome.interp << "\n"
+              << "step: " << failure.outcome.step << "\n"
+              << "opt: " << failure.outcome.optimized << std::endl;
+    return 1;
+}
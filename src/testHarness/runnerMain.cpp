@@ -1,13 +1,48 @@
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <string>
 #include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
 #include "execute.hpp"
 #include <cmath>
 
 const int N = 1000000;
-const int RANDOM_ITERATORS = 100;
-
-static void checkSuccess(ExecResult &r);
+const int RANDOM_ITERATORS = 2000;
+const int TIMEOUT_MILLIS = 10000;
+
+// One program to run, with the output each mode must print. An empty
+// expectation means that mode is not checked.
+class TestCase {
+public:
+    const char *test;
+    std::string input;
+    std::string expectedInterpretResult;
+    std::string expectedOptimizeResult;
+};
+
+// What went wrong running one case, and the resources its programs used
+class CaseResult {
+public:
+    std::string errors;
+    int runs = 0;
+    double cpuSeconds = 0;
+    long maxRssKb = 0;
+};
+
+class Commands {
+public:
+    const char *interp[3];
+    const char *opt[3];
+    const char *step[3];
+};
+
+static void runCases(const Commands &commands, const std::vector<TestCase> &cases,
+                     std::vector<CaseResult> &results, std::atomic<size_t> &next);
+
+static void checkSuccess(ExecResult &r, CaseResult &result);
 
 static std::string makeBigString(const std::string &word, int size);
 
@@ -15,89 +50,134 @@ static std::string randomWord();
 
 std::string randomLetter();
 
-bool randomAddTwoNumbersTest(const char *const *interpCommand, const char *const *optCommand);
+void randomAddTwoNumbersTest(std::vector<TestCase> &cases, int iterations);
 
-bool randomMultiplyTwoNumbersTest(const char *const *interpCommand, const char *const *optCommand);
+void randomMultiplyTwoNumbersTest(std::vector<TestCase> &cases, int iterations);
 
-bool randomTwoNumberEqualsTest(const char *const *interpCommand, const char *const *optCommand);
+void randomTwoNumberEqualsTest(std::vector<TestCase> &cases, int iterations);
 
 std::string generateBinaryFunctionString(int a, int b, std::string operand);
 
-bool checkOutput(const char *const *interpCommand, const char *const *optCommand, const std::string &userInput,
-                 const std::string &expectedInterpretResult, const std::string &expectedOptimizeResult);
+void checkOutput(const Commands &commands, const TestCase &testCase, CaseResult &result);
 
-bool randomVariableTest(const char *const *optCommand);
+void randomVariableTest(std::vector<TestCase> &cases, int iterations);
 
-bool randomFunctionCallTest(const char *const *interpCommand, const char *const *optCommand);
+void randomFunctionCallTest(std::vector<TestCase> &cases, int iterations);
 
-bool randomLetExpressionTest(const char *const *interpCommand, const char *const *optCommand);
+void randomLetExpressionTest(std::vector<TestCase> &cases, int iterations);
 
-bool randomIfElseExpressionTest(const char *const *interpCommand, const char *const *optCommand);
+void randomIfElseExpressionTest(std::vector<TestCase> &cases, int iterations);
 
+// runnerMain path/to/main [-iterations n] [-jobs n] [-seed n]
+//
+// Generates `n` random cases per test (2000 by default) and runs each
+// through the program's -interp, -step and -opt modes, keeping one
+// case per job (one per core by default) in flight at a time. Failures
+// are reported in the order the cases were generated, so a seed always
+// gives the same report however the jobs interleave.
 int main(int argc, const char *argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: runnerMain path/to/main [-iterations n] [-jobs n] [-seed n]" << std::endl;
+        return 1;
+    }
     const char *pathToProgramToBeTested = argv[1];
+    int iterations = RANDOM_ITERATORS;
+    unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+    unsigned seed = (unsigned) time(nullptr);
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-iterations") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-jobs") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            jobs = (unsigned) atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+            seed = (unsigned) strtoul(argv[++i], nullptr, 10);
+        } else {
+            std::cerr << "bad flag " << argv[i] << std::endl;
+            return 1;
+        }
+    }
 
-    //FIXME remove
-    pathToProgramToBeTested = "/Users/chadhurst/repo/ChadHurst/CS6015/ArithmeticParser/cmake-build-debug/main";
-
-    srand((unsigned) time(nullptr));
-
-    const char *const interpCommand[] = {
-            pathToProgramToBeTested,
-            "-interp",
-            nullptr};
-    const char *const optCommand[] = {
-            pathToProgramToBeTested,
-            "-opt",
-            nullptr};
-    const char *const stepCommand[] = {
-            pathToProgramToBeTested,
-            "-step",
-            nullptr};
-
-    std::cout << "started test on " << interpCommand[0] << "\n\n";
-    bool error = false;
-
-    error = randomIfElseExpressionTest(interpCommand, optCommand) || error;
-
-    error = randomAddTwoNumbersTest(interpCommand, optCommand) || error;
-
-    error = randomMultiplyTwoNumbersTest(interpCommand, optCommand) || error;
-
-    error = randomTwoNumberEqualsTest(interpCommand, optCommand) || error;
-
-    error = randomVariableTest(optCommand) || error;
-
-    error = randomFunctionCallTest(interpCommand, optCommand) || error;
+    srand(seed);
+
+    Commands commands = {
+            {pathToProgramToBeTested, "-interp", nullptr},
+            {pathToProgramToBeTested, "-opt", nullptr},
+            {pathToProgramToBeTested, "-step", nullptr}};
+
+    std::cout << "started test on " << commands.interp[0] << " with seed " << seed << " and " << jobs
+              << " jobs\n\n";
+
+    std::vector<TestCase> cases;
+    randomIfElseExpressionTest(cases, iterations);
+    randomAddTwoNumbersTest(cases, iterations);
+    randomMultiplyTwoNumbersTest(cases, iterations);
+    randomTwoNumberEqualsTest(cases, iterations);
+    randomVariableTest(cases, iterations);
+    randomFunctionCallTest(cases, iterations);
+    randomLetExpressionTest(cases, iterations);
+
+    std::vector<CaseResult> results(cases.size());
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < jobs; i++)
+        workers.emplace_back(runCases, std::cref(commands), std::cref(cases), std::ref(results), std::ref(next));
+    for (std::thread &worker : workers)
+        worker.join();
 
-    error = randomLetExpressionTest(interpCommand, optCommand) || error;
+    bool error = false;
+    int runs = 0;
+    double cpuSeconds = 0;
+    long maxRssKb = 0;
+    for (size_t i = 0; i < cases.size();) {
+        const char *test = cases[i].test;
+        bool testError = false;
+        for (; i < cases.size() && cases[i].test == test; i++) {
+            std::cerr << results[i].errors;
+            testError = testError || !results[i].errors.empty();
+            runs += results[i].runs;
+            cpuSeconds += results[i].cpuSeconds;
+            maxRssKb = std::max(maxRssKb, results[i].maxRssKb);
+        }
+        if (!testError) {
+            std::cout << test << " Passed" << std::endl;
+        }
+        error = error || testError;
+    }
 
     if (!error) {
         std::cout << "all tests passed" << std::endl;
     }
-    return 0;
+    std::cout << runs << " runs, " << cpuSeconds * 1000 / std::max(runs, 1) << " ms child CPU per run, "
+              << maxRssKb << " KB max RSS (upper bound, includes the runner)" << std::endl;
+    return error ? 1 : 0;
 }
 
-bool randomLetExpressionTest(const char *const *interpCommand, const char *const *optCommand) {
-    bool error = false;
-    for (int i = 0; i < RANDOM_ITERATORS; i++) {
+// Run cases, taking the next unclaimed one each time, until none are left
+static void runCases(const Commands &commands, const std::vector<TestCase> &cases,
+                     std::vector<CaseResult> &results, std::atomic<size_t> &next) {
+    for (size_t i = next++; i < cases.size(); i = next++) {
+        try {
+            checkOutput(commands, cases[i], results[i]);
+        } catch (std::runtime_error &exn) {
+            results[i].errors += std::string(exn.what()) + "\n";
+        }
+    }
+}
+
+void randomLetExpressionTest(std::vector<TestCase> &cases, int iterations) {
+    for (int i = 0; i < iterations; i++) {
         int b = rand();
 
         std::string variable = randomLetter();
         std::string number = std::to_string(b);
         std::string string = "_let " + variable + " = " + number + " _in " + variable + "\n";
 
-        error = error || checkOutput(interpCommand, optCommand, string, number + "\n", number + "\n");
-    }
-    if (!error) {
-        std::cout << "randomLetExpressionTest Passed" << std::endl;
+        cases.push_back({"randomLetExpressionTest", string, number + "\n", number + "\n"});
     }
-    return error;
 }
 
-bool randomIfElseExpressionTest(const char *const *interpCommand, const char *const *optCommand) {
-    bool error = false;
-    for (int i = 0; i < RANDOM_ITERATORS; i++) {
+void randomIfElseExpressionTest(std::vector<TestCase> &cases, int iterations) {
+    for (int i = 0; i < iterations; i++) {
         int a = rand();
         int b = rand();
 
@@ -118,118 +198,87 @@ bool randomIfElseExpressionTest(const char *const *interpCommand, const char *co
         } else {
             answer = number2;
         }
-        error = error || checkOutput(interpCommand, optCommand, string, answer + "\n", answer + "\n");
-    }
-    if (!error) {
-        std::cout << "randomIfElseExpressionTest Passed" << std::endl;
+        cases.push_back({"randomIfElseExpressionTest", string, answer + "\n", answer + "\n"});
     }
-    return error;
 }
 
-bool randomFunctionCallTest(const char *const *interpCommand, const char *const *optCommand) {
-    bool error = false;
-    for (int i = 0; i < RANDOM_ITERATORS; i++) {
+void randomFunctionCallTest(std::vector<TestCase> &cases, int iterations) {
+    for (int i = 0; i < iterations; i++) {
         std::string number = std::to_string(rand());
         std::string variable = randomLetter();
 
         std::string basicFunctionCallString = "(_fun (" + variable + ") " + variable + ")(" + number + ")\n";
-        error = checkOutput(interpCommand, optCommand, basicFunctionCallString, number + "\n",
-                            basicFunctionCallString) || error;
-    }
-    if (!error) {
-        std::cout << "randomFunctionCallTest Passed" << std::endl;
+        cases.push_back({"randomFunctionCallTest", basicFunctionCallString, number + "\n", basicFunctionCallString});
     }
-    return error;
 }
 
-bool randomVariableTest(const char *const *optCommand) {
-    bool error = false;
-    for (int i = 0; i < RANDOM_ITERATORS; i++) {
+void randomVariableTest(std::vector<TestCase> &cases, int iterations) {
+    for (int i = 0; i < iterations; i++) {
         std::string variableString = randomLetter() + '\n';
-        ExecResult varResult = execProgram(optCommand, variableString);
-        checkSuccess(varResult);
 
         //TODO check errors on interp
-        if (variableString != varResult.out) {
-            error = true;
-            std::cerr << "expected got\n" << variableString << "\n" << varResult.out << "\n";
-        }
-    }
-    if (!error) {
-        std::cout << "randomVariableTest Passed" << std::endl;
+        cases.push_back({"randomVariableTest", variableString, "", variableString});
     }
-    return error;
 }
 
-bool randomAddTwoNumbersTest(const char *const *interpCommand, const char *const *optCommand) {
-    bool error = false;
-    for (int i = 0; i < RANDOM_ITERATORS; i++) {
+void randomAddTwoNumbersTest(std::vector<TestCase> &cases, int iterations) {
+    for (int i = 0; i < iterations; i++) {
         int a = rand() / 2;
         int b = rand() / 2;
         std::string randomAddString = generateBinaryFunctionString(a, b, "+");
         std::string trueInterpAddResult = std::to_string(a + b) + '\n';
         std::string trueOptimizeAddResult = std::to_string(a + b) + '\n';
-        error = checkOutput(interpCommand, optCommand, randomAddString, trueInterpAddResult, trueOptimizeAddResult) ||
-                error;
+        cases.push_back({"randomAddTwoNumbersTest", randomAddString, trueInterpAddResult, trueOptimizeAddResult});
     }
-    if (!error) {
-        std::cout << "randomAddTwoNumbersTest Passed" << std::endl;
-    }
-    return error;
 }
 
-bool randomMultiplyTwoNumbersTest(const char *const *interpCommand, const char *const *optCommand) {
-    bool error = false;
-    for (int i = 0; i < RANDOM_ITERATORS; i++) {
+void randomMultiplyTwoNumbersTest(std::vector<TestCase> &cases, int iterations) {
+    for (int i = 0; i < iterations; i++) {
         int a = (int) sqrt(rand());
         int b = (int) sqrt(rand());
         std::string randomMultiplyString = generateBinaryFunctionString(a, b, "*");
         std::string trueInterpretMultiplyResult = std::to_string(a * b) + '\n';
         std::string trueOptimizeMultiplyResult = std::to_string(a * b) + '\n';
 
-        error = checkOutput(interpCommand, optCommand, randomMultiplyString, trueInterpretMultiplyResult,
-                            trueOptimizeMultiplyResult) || error;
-    }
-    if (!error) {
-        std::cout << "randomMultiplyTwoNumbersTest Passed" << std::endl;
+        cases.push_back({"randomMultiplyTwoNumbersTest", randomMultiplyString, trueInterpretMultiplyResult,
+                         trueOptimizeMultiplyResult});
     }
-    return error;
 }
 
-bool randomTwoNumberEqualsTest(const char *const *interpCommand, const char *const *optCommand) {
-    bool error = false;
-    for (int i = 0; i < RANDOM_ITERATORS; i++) {
+void randomTwoNumberEqualsTest(std::vector<TestCase> &cases, int iterations) {
+    for (int i = 0; i < iterations; i++) {
         int a = rand();
         std::string randomMultiplyString = generateBinaryFunctionString(a, a, "==");
 
-        error = checkOutput(interpCommand, optCommand, randomMultiplyString, "_true\n",
-                            "_true\n") || error;
+        cases.push_back({"randomTwoNumberEqualsTest", randomMultiplyString, "_true\n", "_true\n"});
     }
-    if (!error) {
-        std::cout << "randomTwoNumberEqualsTest Passed" << std::endl;
-    }
-    return error;
 }
 
-bool checkOutput(const char *const *interpCommand, const char *const *optCommand, const std::string &userInput,
-                 const std::string &expectedInterpretResult, const std::string &expectedOptimizeResult) {
-    bool error = false;
-    ExecResult interpCommandResult = execProgram(interpCommand, userInput);
-    ExecResult optCommandResult = execProgram(optCommand, userInput);
-    checkSuccess(interpCommandResult);
-    checkSuccess(optCommandResult);
-
-    if (expectedInterpretResult != interpCommandResult.out) {
-        error = true;
-        std::cerr << "expected\n" << expectedInterpretResult << "got\n" << interpCommandResult.out << "in\n"
-                  << userInput << "with interp\n\n";
+// Run one case in every mode it has an expectation for; -step must
+// print what -interp does
+void checkOutput(const Commands &commands, const TestCase &testCase, CaseResult &result) {
+    std::string &errors = result.errors;
+    if (!testCase.expectedInterpretResult.empty()) {
+        ExecResult interpCommandResult = execProgram(commands.interp, testCase.input, TIMEOUT_MILLIS);
+        ExecResult stepCommandResult = execProgram(commands.step, testCase.input, TIMEOUT_MILLIS);
+        checkSuccess(interpCommandResult, result);
+        checkSuccess(stepCommandResult, result);
+
+        if (testCase.expectedInterpretResult != interpCommandResult.out) {
+            errors += "expected\n" + testCase.expectedInterpretResult + "got\n" + interpCommandResult.out + "in\n"
+                      + testCase.input + "with interp\n\n";
+        }
+        if (testCase.expectedInterpretResult != stepCommandResult.out) {
+            errors += "expected\n" + testCase.expectedInterpretResult + "got\n" + stepCommandResult.out + "in\n"
+                      + testCase.input + "with step\n\n";
+        }
     }
-    if (expectedOptimizeResult != optCommandResult.out) {
-        error = true;
-        std::cerr << "expected\n" << expectedOptimizeResult << "got\n" << optCommandResult.out << "in\n"
-                  << userInput << "with opt\n\n";
+    ExecResult optCommandResult = execProgram(commands.opt, testCase.input, TIMEOUT_MILLIS);
+    checkSuccess(optCommandResult, result);
+    if (testCase.expectedOptimizeResult != optCommandResult.out) {
+        errors += "expected\n" + testCase.expectedOptimizeResult + "got\n" + optCommandResult.out + "in\n"
+                  + testCase.input + "with opt\n\n";
     }
-    return error;
 }
 
 std::string generateBinaryFunctionString(int a, int b, std::string operand) {
@@ -243,11 +292,17 @@ std::string randomLetter() {
     return string;
 }
 
-static void checkSuccess(ExecResult &r) {
-    std::cerr << r.err;
+static void checkSuccess(ExecResult &r, CaseResult &result) {
+    result.runs++;
+    result.cpuSeconds += r.userSeconds + r.systemSeconds;
+    result.maxRssKb = std::max(result.maxRssKb, r.maxRssKb);
+    result.errors += r.err;
+    if (r.timedOut) {
+        result.errors += "timed out after " + std::to_string(TIMEOUT_MILLIS) + " ms\n";
+    }
     if (r.exitCode != 0) {
-        std::cerr << "non-zero exit: " << r.exitCode << "\n";
-        std::cerr << r.out << "\n";
+        result.errors += "non-zero exit: " + std::to_string(r.exitCode) + "\n";
+        result.errors += r.out + "\n";
     }
 }
 